@@ -63,6 +63,8 @@
 
 #include "lib/list.h"
 #include "maze.h"
+#include "negotiate.h"
+#include "path.h"
 #include "router.h"
 #include "lib/timer.h"
 #include "lib/types.h"
@@ -73,6 +75,22 @@ enum param_types {
   PARAM_YCOST  = (unsigned char)'y',
   PARAM_ZCOST  = (unsigned char)'z',
   PARAM_NTHREADS  = (unsigned char)'t',
+  PARAM_EXPANSION = (unsigned char)'e',
+  PARAM_WINDOW = (unsigned char)'w',
+  PARAM_SCRATCH = (unsigned char)'s',
+  PARAM_CELLBITS = (unsigned char)'c',
+  PARAM_LAYOUT = (unsigned char)'l',
+  PARAM_TRACEBACK = (unsigned char)'r',
+  PARAM_ORDER = (unsigned char)'o',
+  PARAM_SEED = (unsigned char)'d',
+  PARAM_NEGOTIATE = (unsigned char)'n',
+  PARAM_BUDGET = (unsigned char)'u',
+  PARAM_DELTA = (unsigned char)'p',
+  PARAM_SCHEDULE = (unsigned char)'m',
+  PARAM_COMMIT = (unsigned char)'k',
+  PARAM_CONTENTION = (unsigned char)'a',
+  PARAM_REPAIR = (unsigned char)'f',
+  PARAM_BATCH = (unsigned char)'g',
 };
 
 enum param_defaults {
@@ -80,6 +98,22 @@ enum param_defaults {
   PARAM_DEFAULT_XCOST  = 1,
   PARAM_DEFAULT_YCOST  = 1,
   PARAM_DEFAULT_ZCOST  = 2,
+  PARAM_DEFAULT_EXPANSION = ROUTER_EXPANSION_LEE,
+  PARAM_DEFAULT_WINDOW = -1,
+  PARAM_DEFAULT_SCRATCH = ROUTER_SCRATCH_COPY,
+  PARAM_DEFAULT_CELLBITS = 64,
+  PARAM_DEFAULT_LAYOUT = GRID_LAYOUT_LINEAR,
+  PARAM_DEFAULT_TRACEBACK = ROUTER_TRACEBACK_SCAN,
+  PARAM_DEFAULT_ORDER = MAZE_ORDER_DISTANCE,
+  PARAM_DEFAULT_SEED = 0,
+  PARAM_DEFAULT_NEGOTIATE = 0,
+  PARAM_DEFAULT_BUDGET = 0,
+  PARAM_DEFAULT_DELTA = -1,
+  PARAM_DEFAULT_SCHEDULE = ROUTER_SCHEDULE_NETS,
+  PARAM_DEFAULT_COMMIT = GRID_COMMIT_LOCK,
+  PARAM_DEFAULT_CONTENTION = CONTENTION_POLICY_BACKOFF,
+  PARAM_DEFAULT_REPAIR = -1,
+  PARAM_DEFAULT_BATCH = BATCH_DEFAULT_SIZE,
 };
 
 bool_t global_doPrint = TRUE;
@@ -99,6 +133,26 @@ static void displayUsage (const char* appName){
   fprintf(stderr, "  x\t<UINT>\t\t[x] movement cost\t(%i)\n", PARAM_DEFAULT_XCOST);
   fprintf(stderr, "  y\t<UINT>\t\t[y] movement cost\t(%i)\n", PARAM_DEFAULT_YCOST);
   fprintf(stderr, "  z\t<UINT>\t\t[z] movement cost\t(%i)\n", PARAM_DEFAULT_ZCOST);
+  fprintf(stderr, "  e\t<lee|astar|bidir|dial|bitset|sweep|delta>\t[e]xpansion engine\t(lee)\n");
+  fputs(          "   \t\t\t(bitset needs equal, positive x/y/z costs, else lee is used)\n", stderr);
+  fprintf(stderr, "  w\t<INT>\t\tbounding box [w]indow margin\t(%i: whole grid)\n", PARAM_DEFAULT_WINDOW);
+  fprintf(stderr, "  s\t<copy|epoch>\tper-net [s]cratch grid\t(copy)\n");
+  fprintf(stderr, "  c\t<64|32|16>\tprivate grid [c]ell bits\t(%i)\n", PARAM_DEFAULT_CELLBITS);
+  fputs(          "   \t\t\t(only if the labels fit: 16 bits suits tiny boards only)\n", stderr);
+  fprintf(stderr, "  l\t<linear|tiled>\tgrid memory [l]ayout\t(linear)\n");
+  fprintf(stderr, "  r\t<scan|arrival>\tt[r]aceback\t\t(scan)\n");
+  fprintf(stderr, "  o\t<distance|shortest|longest|area|hilbert|random>\tnet [o]rder\t(distance)\n");
+  fprintf(stderr, "  d\t<INT>\t\trandom order see[d]\t(%i)\n", PARAM_DEFAULT_SEED);
+  fprintf(stderr, "  n\t<INT>\t\t[n]egotiated congestion rounds\t(%i: off)\n", PARAM_DEFAULT_NEGOTIATE);
+  fputs(          "   \t\t\t(routes on its own: -b -e -w -s -c -r -p -m -g -k -a -f are ignored)\n", stderr);
+  fprintf(stderr, "  u\t<MSEC>\t\tnegotiation round b[u]dget\t(%i: none)\n", PARAM_DEFAULT_BUDGET);
+  fprintf(stderr, "  p\t<INT>\t\tnet length for [p]arallel delta expansion\t(%i: off)\n", PARAM_DEFAULT_DELTA);
+  fprintf(stderr, "  m\t<nets|hybrid|spatial|steal|batch>\tthread scheduling [m]ode\t(nets)\n");
+  fprintf(stderr, "  g\t<POSINT>\tnets per batch [g]roup\t(%i)\n", PARAM_DEFAULT_BATCH);
+  fputs(          "   \t\t\t(batch results depend on it only, not on the threads)\n", stderr);
+  fprintf(stderr, "  k\t<lock|cas|tile|version|stm>\tpath commit loc[k]ing\t(lock)\n");
+  fprintf(stderr, "  a\t<backoff|spin|age>\tcontention m[a]nager\t(backoff)\n");
+  fprintf(stderr, "  f\t<INT>\t\tmargin to [f]ix taken paths in\t(%i: off, reroute)\n", PARAM_DEFAULT_REPAIR);
   fprintf(stderr, "  h\t\t\t[h]elp message\t\t(false)\n");
   fprintf(stderr, "  t\t<POSINT>\tnumber of [t]hreads\t(mandatory)\n");
   exit(1);
@@ -115,6 +169,57 @@ static void setDefaultParams (){
   global_params[PARAM_YCOST]  = PARAM_DEFAULT_YCOST;
   global_params[PARAM_ZCOST]  = PARAM_DEFAULT_ZCOST;
   global_params[PARAM_NTHREADS] = 0;
+  global_params[PARAM_EXPANSION] = PARAM_DEFAULT_EXPANSION;
+  global_params[PARAM_WINDOW] = PARAM_DEFAULT_WINDOW;
+  global_params[PARAM_SCRATCH] = PARAM_DEFAULT_SCRATCH;
+  global_params[PARAM_CELLBITS] = PARAM_DEFAULT_CELLBITS;
+  global_params[PARAM_LAYOUT] = PARAM_DEFAULT_LAYOUT;
+  global_params[PARAM_TRACEBACK] = PARAM_DEFAULT_TRACEBACK;
+  global_params[PARAM_ORDER] = PARAM_DEFAULT_ORDER;
+  global_params[PARAM_SEED] = PARAM_DEFAULT_SEED;
+  global_params[PARAM_NEGOTIATE] = PARAM_DEFAULT_NEGOTIATE;
+  global_params[PARAM_BUDGET] = PARAM_DEFAULT_BUDGET;
+  global_params[PARAM_DELTA] = PARAM_DEFAULT_DELTA;
+  global_params[PARAM_SCHEDULE] = PARAM_DEFAULT_SCHEDULE;
+  global_params[PARAM_COMMIT] = PARAM_DEFAULT_COMMIT;
+  global_params[PARAM_CONTENTION] = PARAM_DEFAULT_CONTENTION;
+  global_params[PARAM_REPAIR] = PARAM_DEFAULT_REPAIR;
+  global_params[PARAM_BATCH] = PARAM_DEFAULT_BATCH;
+}
+
+
+/* =============================================================================
+ * dropNegotiateParams
+ * -- Negotiated routing has its own engine, traceback and commit, and
+ *    schedules nets itself: the options only the other routers use are
+ *    reset to their defaults, so nothing is set up for them, and a note
+ *    lists the ones that were given
+ * =============================================================================
+ */
+static void dropNegotiateParams (){
+  static const char unused[] = "bewscrpmgkaf";
+  long params[256];
+  char given[3 * sizeof(unused)];
+  long numGiven = 0;
+  long i;
+
+  memcpy(params, global_params, sizeof(params));
+  setDefaultParams();
+  for (i = 0; unused[i] != '\0'; i++) {
+    unsigned char opt = (unsigned char)unused[i];
+    if (params[opt] != global_params[opt]) {
+      given[numGiven++] = ' ';
+      given[numGiven++] = '-';
+      given[numGiven++] = (char)opt;
+    }
+    params[opt] = global_params[opt];
+  }
+  given[numGiven] = '\0';
+  memcpy(global_params, params, sizeof(params));
+
+  if (numGiven > 0) {
+    fprintf(stderr, "negotiated routing (-n) ignores%s\n", given);
+  }
 }
 
 
@@ -129,15 +234,79 @@ static void parseArgs (long argc, char* const argv[]){
 
   setDefaultParams();
 
-  while ((opt = getopt(argc, argv, "hb:x:y:z:t:")) != -1) {
+  while ((opt = getopt(argc, argv, "hb:x:y:z:t:e:w:s:c:l:r:o:d:n:u:p:m:k:a:f:g:")) != -1) {
     switch (opt) {
       case 'b':
       case 'x':
       case 'y':
       case 'z':
       case 't':
+      case 'w':
+      case 'c':
+      case 'd':
+      case 'n':
+      case 'u':
+      case 'p':
+      case 'f':
+      case 'g':
         global_params[(unsigned char)opt] = atol(optarg);
         break;
+      case 'e':
+        global_params[PARAM_EXPANSION] = router_parseExpansion(optarg);
+        if (global_params[PARAM_EXPANSION] == ROUTER_EXPANSION_INVALID) {
+          fprintf(stderr, "Unknown expansion engine: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 's':
+        global_params[PARAM_SCRATCH] = router_parseScratch(optarg);
+        if (global_params[PARAM_SCRATCH] == ROUTER_SCRATCH_INVALID) {
+          fprintf(stderr, "Unknown scratch grid: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 'l':
+        global_params[PARAM_LAYOUT] = grid_parseLayout(optarg);
+        if (global_params[PARAM_LAYOUT] == GRID_LAYOUT_INVALID) {
+          fprintf(stderr, "Unknown grid layout: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 'r':
+        global_params[PARAM_TRACEBACK] = router_parseTraceback(optarg);
+        if (global_params[PARAM_TRACEBACK] == ROUTER_TRACEBACK_INVALID) {
+          fprintf(stderr, "Unknown traceback: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 'o':
+        global_params[PARAM_ORDER] = maze_parseOrder(optarg);
+        if (global_params[PARAM_ORDER] == MAZE_ORDER_INVALID) {
+          fprintf(stderr, "Unknown net order: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 'm':
+        global_params[PARAM_SCHEDULE] = router_parseSchedule(optarg);
+        if (global_params[PARAM_SCHEDULE] == ROUTER_SCHEDULE_INVALID) {
+          fprintf(stderr, "Unknown scheduling mode: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 'k':
+        global_params[PARAM_COMMIT] = grid_parseCommit(optarg);
+        if (global_params[PARAM_COMMIT] == GRID_COMMIT_INVALID) {
+          fprintf(stderr, "Unknown commit locking: %s\n", optarg);
+          opterr++;
+        }
+        break;
+      case 'a':
+        global_params[PARAM_CONTENTION] = contention_parsePolicy(optarg);
+        if (global_params[PARAM_CONTENTION] == CONTENTION_POLICY_INVALID) {
+          fprintf(stderr, "Unknown contention manager: %s\n", optarg);
+          opterr++;
+        }
+        break;
       case '?':
       case 'h':
       default:
@@ -147,6 +316,19 @@ static void parseArgs (long argc, char* const argv[]){
   }
 
 
+  if (global_params[PARAM_CELLBITS] != 64 &&
+      global_params[PARAM_CELLBITS] != 32 &&
+      global_params[PARAM_CELLBITS] != 16)
+  {
+    opterr++;
+    fprintf(stderr, "Cell bits must be 64, 32 or 16 ( %ld )\n", global_params[PARAM_CELLBITS]);
+  }
+
+  if (global_params[PARAM_BATCH] <= 0){
+    opterr++;
+    fprintf(stderr, "Nets per batch must be positive ( %ld <= 0 )\n",  global_params[PARAM_BATCH]);
+  }
+
   if (global_params[PARAM_NTHREADS] <= 0){
     opterr++;
     fprintf(stderr, "Number of threads must be positive ( %ld <= 0 )\n",  global_params[PARAM_NTHREADS]);
@@ -231,6 +413,10 @@ int main(int argc, char** argv){
    */
   parseArgs(argc, (char** const)argv);
 
+  if (global_params[PARAM_NEGOTIATE] > 0) {
+    dropNegotiateParams();
+  }
+
   long nthreads = global_params[PARAM_NTHREADS];
   pthread_t * working_threads = malloc(nthreads * sizeof(pthread_t));
   if (working_threads == NULL) {
@@ -241,6 +427,14 @@ int main(int argc, char** argv){
   
   maze_t* mazePtr = maze_alloc();
   assert(mazePtr);
+  mazePtr->layout = global_params[PARAM_LAYOUT];
+  mazePtr->commit = global_params[PARAM_COMMIT];
+  if (global_params[PARAM_NEGOTIATE] > 0) {
+    /* negotiate_run keeps paths in its nets, never in the shared grid */
+    mazePtr->commit = GRID_COMMIT_NONE;
+  }
+  mazePtr->order = global_params[PARAM_ORDER];
+  mazePtr->orderSeed = global_params[PARAM_SEED];
 
   FILE * out_stream = open_out_stream(global_inputFile);
   assert(out_stream);
@@ -249,8 +443,35 @@ int main(int argc, char** argv){
   router_t* routerPtr = router_alloc(global_params[PARAM_XCOST],
                     global_params[PARAM_YCOST],
                     global_params[PARAM_ZCOST],
-                    global_params[PARAM_BENDCOST]);
+                    global_params[PARAM_BENDCOST],
+                    global_params[PARAM_EXPANSION]);
   assert(routerPtr);
+  if (routerPtr->expansion == ROUTER_EXPANSION_BITSET &&
+      (routerPtr->xCost <= 0 || routerPtr->xCost != routerPtr->yCost || routerPtr->yCost != routerPtr->zCost))
+  {
+    /* a breadth-first wave counts moves: with other costs its paths are not the cheapest */
+    fputs("bitset expansion needs equal, positive x/y/z costs: using lee\n", stderr);
+    routerPtr->expansion = ROUTER_EXPANSION_LEE;
+  }
+  routerPtr->windowMargin = global_params[PARAM_WINDOW];
+  routerPtr->scratch = global_params[PARAM_SCRATCH];
+  if (mazePtr->commit == GRID_COMMIT_VERSION) {
+    /* versions are recorded as the shared grid is read: no copy to take */
+    routerPtr->scratch = ROUTER_SCRATCH_EPOCH;
+  }
+  routerPtr->cellBits = global_params[PARAM_CELLBITS];
+  grid_cell_t cellType = router_selectCellType(routerPtr, mazePtr->gridPtr);
+  long cellBits = ((cellType == GRID_CELL_INT16) ? 16 : ((cellType == GRID_CELL_INT32) ? 32 : 64));
+  if (cellBits != routerPtr->cellBits) {
+    fprintf(stderr, "%ld-bit cells cannot hold every label on this board: using %ld-bit cells\n",
+            routerPtr->cellBits, cellBits);
+  }
+  routerPtr->traceback = global_params[PARAM_TRACEBACK];
+  routerPtr->negotiateIterations = global_params[PARAM_NEGOTIATE];
+  routerPtr->negotiateBudget = global_params[PARAM_BUDGET];
+  routerPtr->deltaThreshold = global_params[PARAM_DELTA];
+  routerPtr->schedule = global_params[PARAM_SCHEDULE];
+  routerPtr->repairMargin = global_params[PARAM_REPAIR];
   list_t* pathVectorListPtr = list_alloc(NULL);
   assert(pathVectorListPtr);
 
@@ -272,16 +493,45 @@ int main(int argc, char** argv){
   seed = (unsigned int) (((curr_time.tv_sec >> (sizeof(unsigned int)/4 - 1) ) & (sizeof(unsigned int)/2 - 1)) ^ (curr_time.tv_nsec & (sizeof(unsigned int) - 1)));
   srandom(seed);
 
-  router_solve_arg_t routerArg = {routerPtr, mazePtr, pathVectorListPtr, workQueueMutex, listMutex};
+  router_stats_t stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  router_crew_t* crewPtr = NULL;
+  if (routerPtr->expansion == ROUTER_EXPANSION_DELTA || routerPtr->deltaThreshold >= 0 ||
+      routerPtr->schedule == ROUTER_SCHEDULE_HYBRID)
+  {
+    crewPtr = router_crew_alloc(nthreads);
+    assert(crewPtr);
+  }
+  partition_t* partitionPtr = NULL;
+  if (routerPtr->schedule == ROUTER_SCHEDULE_SPATIAL) {
+    partitionPtr = partition_alloc(mazePtr->gridPtr, ((routerPtr->windowMargin >= 0) ? routerPtr->windowMargin : PARTITION_DEFAULT_MARGIN));
+    assert(partitionPtr);
+  }
+  steal_t* stealPtr = NULL;
+  if (routerPtr->schedule == ROUTER_SCHEDULE_STEAL) {
+    stealPtr = steal_alloc(nthreads, mazePtr->workQueuePtr);
+    assert(stealPtr);
+  }
+  contention_manager_t* contentionManagerPtr = contention_manager_alloc(global_params[PARAM_CONTENTION], nthreads);
+  assert(contentionManagerPtr);
+  batch_t* batchPtr = NULL;
+  if (routerPtr->schedule == ROUTER_SCHEDULE_BATCH) {
+    batchPtr = batch_alloc(nthreads, global_params[PARAM_BATCH]);
+    assert(batchPtr);
+  }
+  router_solve_arg_t routerArg = {routerPtr, mazePtr, pathVectorListPtr, workQueueMutex, listMutex, &stats, crewPtr, partitionPtr, stealPtr, contentionManagerPtr, batchPtr};
   TIMER_T startTime;
   TIMER_READ(startTime);
 
 
-  for (long i = 0; i < nthreads; i++) 
-    Pthread_create(abort_exec, "failed to create thread", &working_threads[i], NULL, router_solve, (void *)&routerArg);
+  if (routerPtr->negotiateIterations > 0) {
+    negotiate_run(routerPtr, mazePtr, nthreads, pathVectorListPtr, &stats);
+  } else {
+    for (long i = 0; i < nthreads; i++) 
+      Pthread_create(abort_exec, "failed to create thread", &working_threads[i], NULL, router_solve, (void *)&routerArg);
   
-  for (long i = 0; i < nthreads; i++) 
-    Pthread_join(abort_exec, "failed to join thread", working_threads[i], NULL);
+    for (long i = 0; i < nthreads; i++) 
+      Pthread_join(abort_exec, "failed to join thread", working_threads[i], NULL);
+  }
 
   TIMER_T stopTime;
   TIMER_READ(stopTime);
@@ -291,6 +541,27 @@ int main(int argc, char** argv){
   free(workQueueMutex);
   Pthread_mutex_destroy(print_error, "failed to destroy mutex", listMutex);
   free(listMutex);
+  if (crewPtr) {
+    router_crew_free(crewPtr);
+  }
+  if (partitionPtr) {
+    stats.deferrals = partitionPtr->numDeferral;
+    stats.overlaps = partitionPtr->numOverlap;
+    partition_free(partitionPtr);
+  }
+  if (stealPtr) {
+    steal_free(stealPtr);
+  }
+  contention_manager_free(contentionManagerPtr);
+  double batchIdle = 0.0;
+  double batchSerial = 0.0;
+  if (batchPtr) {
+    stats.iterations = batchPtr->numBatch;
+    batchIdle = batchPtr->idleSeconds;
+    batchSerial = batchPtr->serialSeconds;
+    list_insert(pathVectorListPtr, (void*)batchPtr->pathVectorPtr);
+    batch_free(batchPtr);
+  }
 
   long numPathRouted = 0;
   list_iter_t it;
@@ -301,6 +572,21 @@ int main(int argc, char** argv){
   }
   fprintf(out_stream, "Paths routed  = %li\n", numPathRouted);
   fprintf(out_stream, "Elapsed time  = %f seconds\n", TIMER_DIFF_SECONDS(startTime, stopTime));
+  fprintf(out_stream, "Cells pushed  = %li\n", stats.pushes);
+  fprintf(out_stream, "Expansions    = %li\n", stats.expansions);
+  fprintf(out_stream, "Re-expansions = %li\n", stats.reexpansions);
+  fprintf(out_stream, "Retries       = %li\n", stats.retries);
+  fprintf(out_stream, "Iterations    = %li\n", stats.iterations);
+  fprintf(out_stream, "Team joins    = %li\n", stats.joins);
+  fprintf(out_stream, "Deferrals     = %li\n", stats.deferrals);
+  fprintf(out_stream, "Overlaps      = %li\n", stats.overlaps);
+  fprintf(out_stream, "Steals        = %li\n", stats.steals);
+  fprintf(out_stream, "Repairs       = %li\n", stats.repairs);
+  fprintf(out_stream, "Commits tried = %li\n", stats.attempts);
+  fprintf(out_stream, "Busy points   = %li\n", stats.busy);
+  fprintf(out_stream, "Aborts        = %li\n", stats.aborts);
+  fprintf(out_stream, "Batch idle    = %f seconds\n", batchIdle);
+  fprintf(out_stream, "Batch serial  = %f seconds\n", batchSerial);
 
 
   /*
@@ -318,10 +604,9 @@ int main(int argc, char** argv){
   list_iter_reset(&it, pathVectorListPtr);
   while (list_iter_hasNext(&it, pathVectorListPtr)) {
     vector_t* pathVectorPtr = (vector_t*)list_iter_next(&it, pathVectorListPtr);
-    vector_t* v;
-    while((v = vector_popBack(pathVectorPtr))) {
-      // v stores pointers to longs stored elsewhere; no need to free them here
-      vector_free(v);
+    path_t* pathPtr;
+    while((pathPtr = vector_popBack(pathVectorPtr))) {
+      path_free(pathPtr);
     }
     vector_free(pathVectorPtr);
   }
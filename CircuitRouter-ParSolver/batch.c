@@ -0,0 +1,180 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * batch.c
+ *
+ * deterministic batches of nets
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "batch.h"
+#include "pthread_wrappers.h"
+#include "lib/pair.h"
+#include "lib/queue.h"
+#include "lib/timer.h"
+#include "lib/types.h"
+#include "lib/vector.h"
+
+
+/* =============================================================================
+ * batch_alloc
+ * -- Batches of size nets, routed by numThread threads
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+batch_t* batch_alloc (long numThread, long size){
+  assert(numThread > 0 && size > 0);
+  batch_t* batchPtr = (batch_t*)malloc(sizeof(batch_t));
+  if (batchPtr == NULL) {
+    return NULL;
+  }
+  batchPtr->slots = (batch_slot_t*)calloc(size, sizeof(batch_slot_t));
+  batchPtr->pathVectorPtr = vector_alloc(1);
+  if (batchPtr->slots == NULL || batchPtr->pathVectorPtr == NULL) {
+    if (batchPtr->pathVectorPtr) {
+      vector_free(batchPtr->pathVectorPtr);
+    }
+    free(batchPtr->slots);
+    free(batchPtr);
+    return NULL;
+  }
+  long i;
+  for (i = 0; i < size; i++) {
+    batchPtr->slots[i].pointVectorPtr = vector_alloc(1);
+    assert(batchPtr->slots[i].pointVectorPtr);
+  }
+
+  Pthread_mutex_init(abort_exec, "batch_alloc: failed to initialize mutex", &batchPtr->mutex, NULL);
+  Pthread_cond_init(abort_exec, "batch_alloc: failed to initialize condition", &batchPtr->cond, NULL);
+  batchPtr->numThread = numThread;
+  batchPtr->numWaiting = 0;
+  batchPtr->generation = 0;
+  batchPtr->size = size;
+  batchPtr->numSlot = 0;
+  batchPtr->numClaimed = 0;
+  batchPtr->numKept = 0;
+  batchPtr->numBatch = 0;
+  batchPtr->idleSeconds = 0.0;
+  batchPtr->serialSeconds = 0.0;
+
+  return batchPtr;
+}
+
+
+/* =============================================================================
+ * batch_free
+ * -- The vector of paths committed is left to the caller
+ * =============================================================================
+ */
+void batch_free (batch_t* batchPtr){
+  long i;
+  for (i = 0; i < batchPtr->size; i++) {
+    vector_free(batchPtr->slots[i].pointVectorPtr);
+  }
+  free(batchPtr->slots);
+  Pthread_cond_destroy(print_error, "batch_free: failed to destroy condition", &batchPtr->cond);
+  Pthread_mutex_destroy(print_error, "batch_free: failed to destroy mutex", &batchPtr->mutex);
+  free(batchPtr);
+}
+
+
+/* =============================================================================
+ * batch_wait
+ * -- Barrier of all numThread threads
+ * -- Returns TRUE in exactly one of them, the one to do the serial work
+ *    before the next barrier
+ * =============================================================================
+ */
+bool_t batch_wait (batch_t* batchPtr){
+  bool_t isLast = FALSE;
+
+  Pthread_mutex_lock(abort_exec, "batch_wait: failed to lock mutex", &batchPtr->mutex);
+  long generation = batchPtr->generation;
+  if (++batchPtr->numWaiting == batchPtr->numThread) {
+    batchPtr->numWaiting = 0;
+    batchPtr->generation++;
+    isLast = TRUE;
+    Pthread_cond_broadcast(abort_exec, "batch_wait: failed to broadcast", &batchPtr->cond);
+  } else {
+    TIMER_T startTime;
+    TIMER_READ(startTime);
+    while (batchPtr->generation == generation) {
+      Pthread_cond_wait(abort_exec, "batch_wait: failed to wait", &batchPtr->cond, &batchPtr->mutex);
+    }
+    TIMER_T stopTime;
+    TIMER_READ(stopTime);
+    batchPtr->idleSeconds += TIMER_DIFF_SECONDS(startTime, stopTime);
+  }
+  Pthread_mutex_unlock(abort_exec, "batch_wait: failed to unlock mutex", &batchPtr->mutex);
+
+  return isLast;
+}
+
+
+/* =============================================================================
+ * batch_fill
+ * -- Serial: makes the nets left in the batch (those to route again, kept
+ *    at its front) the start of the next, topped up from workQueuePtr
+ * -- Returns the number of nets in the new batch, 0 once all are done
+ * =============================================================================
+ */
+long batch_fill (batch_t* batchPtr, queue_t* workQueuePtr){
+  long numSlot = batchPtr->numKept;
+  while (numSlot < batchPtr->size && !queue_isEmpty(workQueuePtr)) {
+    batchPtr->slots[numSlot].coordinatePairPtr = (pair_t*)queue_pop(workQueuePtr);
+    batchPtr->slots[numSlot].isLost = FALSE;
+    numSlot++;
+  }
+
+  long i;
+  for (i = 0; i < numSlot; i++) {
+    batchPtr->slots[i].isRouted = FALSE;
+    batchPtr->slots[i].isRepaired = FALSE;
+  }
+  batchPtr->numSlot = numSlot;
+  batchPtr->numClaimed = 0;
+  batchPtr->numKept = 0;
+  if (numSlot > 0) {
+    batchPtr->numBatch++;
+  }
+
+  return numSlot;
+}
+
+
+/* =============================================================================
+ * batch_claim
+ * -- Returns the slot of the next net of the batch to route, or -1 once all
+ *    are handed out
+ * =============================================================================
+ */
+long batch_claim (batch_t* batchPtr){
+  long i = __atomic_fetch_add(&batchPtr->numClaimed, 1, __ATOMIC_RELAXED);
+  return ((i < batchPtr->numSlot) ? i : -1);
+}
+
+
+/* =============================================================================
+ * batch_requeue
+ * -- Serial, while committing the slots in order: the net of slot i is to
+ *    be routed again, ahead of the nets of the work queue
+ * =============================================================================
+ */
+void batch_requeue (batch_t* batchPtr, long i){
+  assert(batchPtr->numKept <= i);
+  batch_slot_t tmp = batchPtr->slots[batchPtr->numKept];
+  batchPtr->slots[batchPtr->numKept] = batchPtr->slots[i];
+  batchPtr->slots[i] = tmp;
+  batchPtr->slots[batchPtr->numKept].isLost = TRUE;
+  batchPtr->numKept++;
+}
+
+
+/* =============================================================================
+ *
+ * End of batch.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,129 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * batch.h
+ *
+ * deterministic batches of nets: the threads route the nets of a batch in
+ * parallel, all against the same shared grid (nothing is committed while
+ * they route), then a single thread commits the paths found in net order,
+ * and the nets whose path was taken by an earlier one of the batch lead
+ * the next batch. Which thread routes which net does not matter, so the
+ * paths, and the nets left unrouted, only depend on the input and options
+ *
+ * the phases are separated by a barrier, and the thread it elects does the
+ * serial work: committing a batch and taking the next from the work queue.
+ * The commit stays serial because net order is what makes the result
+ * deterministic; it is a check and a write of each path, cheap next to
+ * routing the batch, and both it and the time threads spend waiting at the
+ * barriers are accounted for, so the cost of determinism can be read off.
+ * The batch size is fixed (BATCH_DEFAULT_SIZE unless set), never derived
+ * from the thread count: it decides which nets see the same grid, so the
+ * result depends on it and on nothing else; runs with different thread
+ * counts then give the same paths and can be compared or bisected
+ * =============================================================================
+ */
+
+
+#ifndef BATCH_H
+#define BATCH_H 1
+
+
+#include <pthread.h>
+#include "lib/pair.h"
+#include "lib/queue.h"
+#include "lib/types.h"
+#include "lib/vector.h"
+
+enum batch_config {
+  BATCH_DEFAULT_SIZE = 16, /* default nets per batch, whatever the thread count */
+};
+
+typedef struct batch_slot {
+  pair_t* coordinatePairPtr;
+  vector_t* pointVectorPtr; /* its path, if isRouted, or the path it lost if isLost */
+  bool_t isRouted;
+  bool_t isLost;            /* requeued: an earlier net of its batch took part of its path */
+  bool_t isRepaired;        /* its path is the one it lost, mended (router.h: repairMargin) */
+} batch_slot_t;
+
+typedef struct batch {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  long numThread;
+  long numWaiting;     /* threads at the barrier */
+  long generation;     /* barriers passed */
+  long size;           /* nets per batch */
+  batch_slot_t* slots; /* nets of the current batch, in net order */
+  long numSlot;
+  long numClaimed;     /* slots handed out to route */
+  long numKept;        /* nets to route again, moved to the front as committed */
+  long numBatch;       /* batches routed */
+  vector_t* pathVectorPtr; /* paths committed (path_t), in commit order */
+  double idleSeconds;      /* thread time spent waiting at the barrier, summed */
+  double serialSeconds;    /* time spent on the serial work alone */
+} batch_t;
+
+
+/* =============================================================================
+ * batch_alloc
+ * -- Batches of size nets, routed by numThread threads
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+batch_t* batch_alloc (long numThread, long size);
+
+
+/* =============================================================================
+ * batch_free
+ * -- The vector of paths committed is left to the caller
+ * =============================================================================
+ */
+void batch_free (batch_t* batchPtr);
+
+
+/* =============================================================================
+ * batch_wait
+ * -- Barrier of all numThread threads
+ * -- Returns TRUE in exactly one of them, the one to do the serial work
+ *    before the next barrier
+ * =============================================================================
+ */
+bool_t batch_wait (batch_t* batchPtr);
+
+
+/* =============================================================================
+ * batch_fill
+ * -- Serial: makes the nets left in the batch (those to route again, kept
+ *    at its front) the start of the next, topped up from workQueuePtr
+ * -- Returns the number of nets in the new batch, 0 once all are done
+ * =============================================================================
+ */
+long batch_fill (batch_t* batchPtr, queue_t* workQueuePtr);
+
+
+/* =============================================================================
+ * batch_claim
+ * -- Returns the slot of the next net of the batch to route, or -1 once all
+ *    are handed out
+ * =============================================================================
+ */
+long batch_claim (batch_t* batchPtr);
+
+
+/* =============================================================================
+ * batch_requeue
+ * -- Serial, while committing the slots in order: the net of slot i is to
+ *    be routed again, ahead of the nets of the work queue
+ * =============================================================================
+ */
+void batch_requeue (batch_t* batchPtr, long i);
+
+
+#endif /* BATCH_H */
+
+
+/* =============================================================================
+ *
+ * End of batch.h
+ *
+ * =============================================================================
+ */
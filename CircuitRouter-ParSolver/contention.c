@@ -0,0 +1,313 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * contention.c
+ *
+ * contention manager for path commits
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "contention.h"
+#include "lib/types.h"
+#include "lib/utility.h"
+
+
+#define SPIN_POLLS (1<<6)      /* spin policy: polls spent spinning before yielding */
+#define SPIN_MAX_POLLS (1<<10) /* spin policy: polls before giving up */
+#define BACKOFF_MIN (1<<4)     /* pauses, at most, after the first busy poll */
+#define BACKOFF_MAX (1<<12)    /* beyond that, the CPU is yielded as well */
+#define BACKOFF_MAX_POLLS (1<<4) /* backoff and age policies: polls before giving up */
+
+
+/* =============================================================================
+ * relax
+ * -- One pause in a spin loop
+ * =============================================================================
+ */
+static inline void relax (void){
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+
+/* =============================================================================
+ * nextRandom
+ * -- xorshift64* (Vigna)
+ * =============================================================================
+ */
+static inline uint64_t nextRandom (contention_t* contentionPtr){
+  uint64_t x = contentionPtr->seed;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  contentionPtr->seed = x;
+  return (x * 0x2545F4914F6CDD1DULL);
+}
+
+
+/* =============================================================================
+ * backoff
+ * -- A random wait, up to a bound doubling with each round. With more threads
+ *    than CPUs, the holder may well be waiting for this CPU, so the thread
+ *    sleeps; otherwise it pauses, and yields too once the bound is at its
+ *    largest
+ * =============================================================================
+ */
+static void backoff (contention_t* contentionPtr, long round){
+  long shift = MIN((round - 1), 30);
+  long bound = MIN(((long)BACKOFF_MIN << shift), BACKOFF_MAX);
+  long numPause = (long)(nextRandom(contentionPtr) % (uint64_t)bound);
+  long i;
+  if (contentionPtr->managerPtr->isOversubscribed) {
+    struct timespec req;
+    req.tv_sec = 0;
+    req.tv_nsec = numPause;
+    nanosleep(&req, NULL);
+    return;
+  }
+  for (i = 0; i < numPause; i++) {
+    relax();
+  }
+  if (bound == BACKOFF_MAX) {
+    sched_yield();
+  }
+}
+
+
+/* =============================================================================
+ * isOldest
+ * -- No net being committed holds an older ticket
+ * =============================================================================
+ */
+static bool_t isOldest (contention_t* contentionPtr){
+  contention_manager_t* managerPtr = contentionPtr->managerPtr;
+  long i;
+  for (i = 0; i < managerPtr->numThread; i++) {
+    unsigned long ticket = __atomic_load_n(&managerPtr->tickets[i].ticket, __ATOMIC_ACQUIRE);
+    if (ticket != 0 && ticket < contentionPtr->ticket) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * contention_manager_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+contention_manager_t* contention_manager_alloc (contention_policy_t policy, long numThread){
+  contention_manager_t* managerPtr = (contention_manager_t*)malloc(sizeof(contention_manager_t));
+  if (managerPtr == NULL) {
+    return NULL;
+  }
+  managerPtr->tickets = (contention_ticket_t*)calloc(numThread, sizeof(contention_ticket_t));
+  if (managerPtr->tickets == NULL) {
+    free(managerPtr);
+    return NULL;
+  }
+  managerPtr->policy = policy;
+  managerPtr->numThread = numThread;
+  managerPtr->numJoined = 0;
+  managerPtr->clock = 0;
+  managerPtr->isOversubscribed = (numThread > sysconf(_SC_NPROCESSORS_ONLN));
+
+  return managerPtr;
+}
+
+
+/* =============================================================================
+ * contention_manager_free
+ * =============================================================================
+ */
+void contention_manager_free (contention_manager_t* managerPtr){
+  free(managerPtr->tickets);
+  free(managerPtr);
+}
+
+
+/* =============================================================================
+ * contention_parsePolicy
+ * -- Returns CONTENTION_POLICY_INVALID if the name is unknown
+ * =============================================================================
+ */
+contention_policy_t contention_parsePolicy (const char* name){
+  if (strcmp(name, "backoff") == 0) {
+    return CONTENTION_POLICY_BACKOFF;
+  }
+  if (strcmp(name, "spin") == 0) {
+    return CONTENTION_POLICY_SPIN;
+  }
+  if (strcmp(name, "age") == 0) {
+    return CONTENTION_POLICY_AGE;
+  }
+  return CONTENTION_POLICY_INVALID;
+}
+
+
+/* =============================================================================
+ * contention_alloc
+ * -- State of the calling thread; each thread calls it once
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+contention_t* contention_alloc (contention_manager_t* managerPtr, unsigned long seed){
+  contention_t* contentionPtr = (contention_t*)malloc(sizeof(contention_t));
+  if (contentionPtr == NULL) {
+    return NULL;
+  }
+  contentionPtr->managerPtr = managerPtr;
+  contentionPtr->id = __atomic_fetch_add(&managerPtr->numJoined, 1, __ATOMIC_RELAXED);
+  assert(contentionPtr->id < managerPtr->numThread);
+  /* distinct per thread, even from the same seed */
+  contentionPtr->seed = ((uint64_t)seed ^ ((uint64_t)(contentionPtr->id + 1) * 0x9E3779B97F4A7C15ULL));
+  if (contentionPtr->seed == 0) {
+    contentionPtr->seed = 1;
+  }
+  contentionPtr->ticket = 0;
+  contentionPtr->numAttempt = 0;
+  contentionPtr->numBusy = 0;
+  contentionPtr->numAbort = 0;
+
+  return contentionPtr;
+}
+
+
+/* =============================================================================
+ * contention_free
+ * =============================================================================
+ */
+void contention_free (contention_t* contentionPtr){
+  free(contentionPtr);
+}
+
+
+/* =============================================================================
+ * contention_beginNet
+ * -- The thread starts routing a net (which dates it, under the age policy)
+ * =============================================================================
+ */
+void contention_beginNet (contention_t* contentionPtr){
+  contention_manager_t* managerPtr = contentionPtr->managerPtr;
+  if (managerPtr->policy == CONTENTION_POLICY_AGE) {
+    contentionPtr->ticket = __atomic_add_fetch(&managerPtr->clock, 1, __ATOMIC_RELAXED);
+  }
+}
+
+
+/* =============================================================================
+ * contention_beginCommit
+ * =============================================================================
+ */
+void contention_beginCommit (contention_t* contentionPtr){
+  contention_manager_t* managerPtr = contentionPtr->managerPtr;
+  contentionPtr->numAttempt++;
+  if (managerPtr->policy == CONTENTION_POLICY_AGE) {
+    __atomic_store_n(&managerPtr->tickets[contentionPtr->id].ticket, contentionPtr->ticket, __ATOMIC_RELEASE);
+  }
+}
+
+
+/* =============================================================================
+ * contention_endCommit
+ * =============================================================================
+ */
+void contention_endCommit (contention_t* contentionPtr){
+  contention_manager_t* managerPtr = contentionPtr->managerPtr;
+  if (managerPtr->policy == CONTENTION_POLICY_AGE) {
+    __atomic_store_n(&managerPtr->tickets[contentionPtr->id].ticket, 0, __ATOMIC_RELEASE);
+  }
+}
+
+
+/* =============================================================================
+ * contention_wait
+ * -- Called each time the same point is found busy, numPoll counting from 1;
+ *    waits before it is polled again
+ * -- Returns FALSE if the commit should let go of what it holds instead,
+ *    and call contention_abort before it tries again
+ * =============================================================================
+ */
+bool_t contention_wait (contention_t* contentionPtr, long numPoll){
+  if (numPoll == 1) {
+    contentionPtr->numBusy++;
+  }
+
+  switch (contentionPtr->managerPtr->policy) {
+    case CONTENTION_POLICY_SPIN:
+      if (numPoll > SPIN_MAX_POLLS) {
+        break;
+      }
+      if (numPoll > SPIN_POLLS || contentionPtr->managerPtr->isOversubscribed) {
+        sched_yield();
+      } else {
+        relax();
+      }
+      return TRUE;
+    case CONTENTION_POLICY_AGE:
+      if (numPoll > BACKOFF_MAX_POLLS && isOldest(contentionPtr)) {
+        /* the holder is younger, and will be done or let go soon */
+        sched_yield();
+        return TRUE;
+      }
+      /* fall through */
+    case CONTENTION_POLICY_BACKOFF:
+    default:
+      if (numPoll > BACKOFF_MAX_POLLS) {
+        break;
+      }
+      backoff(contentionPtr, numPoll);
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+/* =============================================================================
+ * contention_abort
+ * -- A commit let go of what it held, or a transaction aborted, for the
+ *    numAbort-th time in a row; waits before it is tried again
+ * =============================================================================
+ */
+void contention_abort (contention_t* contentionPtr, long numAbort){
+  contentionPtr->numAbort++;
+
+  switch (contentionPtr->managerPtr->policy) {
+    case CONTENTION_POLICY_SPIN:
+      if (numAbort > SPIN_POLLS || contentionPtr->managerPtr->isOversubscribed) {
+        sched_yield();
+      } else {
+        relax();
+      }
+      break;
+    case CONTENTION_POLICY_AGE:
+      if (isOldest(contentionPtr)) {
+        break; /* the others are to back off from it */
+      }
+      /* fall through */
+    case CONTENTION_POLICY_BACKOFF:
+    default:
+      backoff(contentionPtr, numAbort);
+      break;
+  }
+}
+
+
+/* =============================================================================
+ *
+ * End of contention.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,158 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * contention.h
+ *
+ * contention manager for path commits: decides how a commit waits on a
+ * point (or tile, or block, or transaction lock) another commit holds, and
+ * when it lets go of the ones it holds itself and, after backing off,
+ * tries the same path again. No commit waits holding points for longer
+ * than the policy allows, and a net is only ever requeued (and rerouted)
+ * for a point some other net has actually taken
+ *
+ * every thread has its own state, with a private PRNG for randomized
+ * backoff (no call into random() and its lock) and counters of its commit
+ * attempts, busy points met and attempts aborted. Waiting spins on a pause
+ * instruction and yields the CPU once it has gone on for long, with no
+ * system call on the way; only with more threads than CPUs, where the
+ * holder of a point may itself be waiting for a CPU, does backoff sleep
+ *
+ * under the age policy, each net gets a ticket from a shared clock when a
+ * thread starts routing it, and the oldest net among those being committed
+ * never lets go or backs off
+ * =============================================================================
+ */
+
+
+#ifndef CONTENTION_H
+#define CONTENTION_H 1
+
+
+#include <stdint.h>
+#include "lib/types.h"
+
+typedef enum contention_policy {
+  CONTENTION_POLICY_INVALID = -1,
+  CONTENTION_POLICY_BACKOFF = 0, /* randomized exponential backoff, giving up after a few rounds */
+  CONTENTION_POLICY_SPIN,        /* spin, then yield, giving up only after long */
+  CONTENTION_POLICY_AGE,         /* backoff, but the oldest net committing waits for as long as it takes */
+} contention_policy_t;
+
+enum contention_config {
+  CONTENTION_PAD_BYTES = 64,     /* one published ticket per cache line */
+};
+
+typedef struct contention_ticket {
+  unsigned long ticket;          /* of the net being committed, 0 if none */
+  char pad[CONTENTION_PAD_BYTES - sizeof(unsigned long)];
+} contention_ticket_t;
+
+typedef struct contention_manager {
+  contention_policy_t policy;
+  long numThread;
+  long numJoined;
+  bool_t isOversubscribed;       /* more threads than CPUs online */
+  unsigned long clock;           /* last ticket handed out */
+  contention_ticket_t* tickets;  /* per thread (age policy only) */
+} contention_manager_t;
+
+typedef struct contention {
+  contention_manager_t* managerPtr;
+  long id;
+  uint64_t seed;                 /* xorshift64* state, never 0 */
+  unsigned long ticket;
+  long numAttempt;               /* commits tried */
+  long numBusy;                  /* points (or locks) found held by another commit */
+  long numAbort;                 /* commits started over, or transactions rerun, on contention */
+} contention_t;
+
+
+/* =============================================================================
+ * contention_manager_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+contention_manager_t* contention_manager_alloc (contention_policy_t policy, long numThread);
+
+
+/* =============================================================================
+ * contention_manager_free
+ * =============================================================================
+ */
+void contention_manager_free (contention_manager_t* managerPtr);
+
+
+/* =============================================================================
+ * contention_parsePolicy
+ * -- Returns CONTENTION_POLICY_INVALID if the name is unknown
+ * =============================================================================
+ */
+contention_policy_t contention_parsePolicy (const char* name);
+
+
+/* =============================================================================
+ * contention_alloc
+ * -- State of the calling thread; each thread calls it once
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+contention_t* contention_alloc (contention_manager_t* managerPtr, unsigned long seed);
+
+
+/* =============================================================================
+ * contention_free
+ * =============================================================================
+ */
+void contention_free (contention_t* contentionPtr);
+
+
+/* =============================================================================
+ * contention_beginNet
+ * -- The thread starts routing a net (which dates it, under the age policy)
+ * =============================================================================
+ */
+void contention_beginNet (contention_t* contentionPtr);
+
+
+/* =============================================================================
+ * contention_beginCommit
+ * =============================================================================
+ */
+void contention_beginCommit (contention_t* contentionPtr);
+
+
+/* =============================================================================
+ * contention_endCommit
+ * =============================================================================
+ */
+void contention_endCommit (contention_t* contentionPtr);
+
+
+/* =============================================================================
+ * contention_wait
+ * -- Called each time the same point is found busy, numPoll counting from 1;
+ *    waits before it is polled again
+ * -- Returns FALSE if the commit should let go of what it holds instead,
+ *    and call contention_abort before it tries again
+ * =============================================================================
+ */
+bool_t contention_wait (contention_t* contentionPtr, long numPoll);
+
+
+/* =============================================================================
+ * contention_abort
+ * -- A commit let go of what it held, or a transaction aborted, for the
+ *    numAbort-th time in a row; waits before it is tried again
+ * =============================================================================
+ */
+void contention_abort (contention_t* contentionPtr, long numAbort);
+
+
+#endif /* CONTENTION_H */
+
+
+/* =============================================================================
+ *
+ * End of contention.h
+ *
+ * =============================================================================
+ */
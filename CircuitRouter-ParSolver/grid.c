@@ -53,27 +53,79 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 #include "pthread_wrappers.h"
 
+#include "contention.h"
 #include "coordinate.h"
 #include "grid.h"
 #include "lib/types.h"
+#include "lib/utility.h"
 #include "lib/vector.h"
 
 
 const unsigned long CACHE_LINE_SIZE = 32UL;
-#define MAX_TRIES (1<<3)
-#define MAX_TIMEOUT (1<<6)
+
+
+/* =============================================================================
+ * cellSize
+ * =============================================================================
+ */
+static long cellSize (grid_cell_t cellType){
+  switch (cellType) {
+    case GRID_CELL_INT16:
+      return sizeof(int16_t);
+    case GRID_CELL_INT32:
+      return sizeof(int32_t);
+    case GRID_CELL_LONG:
+    default:
+      return sizeof(long);
+  }
+}
+
+
+/* =============================================================================
+ * occupancyWordRef, occupancyBit
+ * =============================================================================
+ */
+static inline uint64_t* occupancyWordRef (grid_t* gridPtr, long x, long y, long z){
+  return &gridPtr->occupancy[(z * gridPtr->height + y) * gridPtr->occupancyRowWords
+                             + (x / GRID_OCCUPANCY_WORD_BITS)];
+}
+
+static inline uint64_t occupancyBit (long x){
+  return ((uint64_t)1 << (x % GRID_OCCUPANCY_WORD_BITS));
+}
+
+
+/* =============================================================================
+ * setLayout
+ * -- The tiled layout stores whole bricks, so its edges are padded up to a
+ *    multiple of GRID_TILE_SIZE in x and y; padding points are never valid
+ * =============================================================================
+ */
+static void setLayout (grid_t* gridPtr, grid_layout_t layout){
+  gridPtr->layout = layout;
+  if (layout == GRID_LAYOUT_TILED) {
+    long tilesY = (gridPtr->height + GRID_TILE_MASK) >> GRID_TILE_BITS;
+    gridPtr->tilesX = (gridPtr->width + GRID_TILE_MASK) >> GRID_TILE_BITS;
+    gridPtr->numCell = gridPtr->tilesX * tilesY * gridPtr->depth * GRID_TILE_SIZE * GRID_TILE_SIZE;
+  } else {
+    gridPtr->tilesX = 0;
+    gridPtr->numCell = gridPtr->width * gridPtr->height * gridPtr->depth;
+  }
+}
 
 
 /* =============================================================================
  * grid_alloc
  * =============================================================================
  */
-grid_t* grid_alloc (long width, long height, long depth){
+grid_t* grid_alloc (long width, long height, long depth, grid_layout_t layout, grid_commit_t commit){
   grid_t* gridPtr;
 
   gridPtr = (grid_t*)malloc(sizeof(grid_t));
@@ -81,13 +133,20 @@ grid_t* grid_alloc (long width, long height, long depth){
     gridPtr->width = width;
     gridPtr->height = height;
     gridPtr->depth = depth;
-    long n = width * height * depth;
+    grid_setWindow(gridPtr, 0, 0, 0, width - 1, height - 1, depth - 1);
+    setLayout(gridPtr, layout);
+    long n = gridPtr->numCell;
     long* points_unaligned = (long*)malloc(n * sizeof(long) + CACHE_LINE_SIZE);
     assert(points_unaligned);
     gridPtr->points_unaligned = points_unaligned;
+    gridPtr->commit = commit;
 
-    gridPtr->locks_unaligned = (pthread_mutex_t *)malloc(n * sizeof(pthread_mutex_t) + CACHE_LINE_SIZE);
-    assert(gridPtr->locks_unaligned);
+    if (commit == GRID_COMMIT_LOCK) {
+      gridPtr->locks_unaligned = (pthread_mutex_t *)malloc(n * sizeof(pthread_mutex_t) + CACHE_LINE_SIZE);
+      assert(gridPtr->locks_unaligned);
+    } else {
+      gridPtr->locks_unaligned = NULL;
+    }
 
     /**
      * Pointer black magic explained:
@@ -103,14 +162,52 @@ grid_t* grid_alloc (long width, long height, long depth){
     gridPtr->points = (long*)((char*)(((unsigned long)points_unaligned
                      & ~(CACHE_LINE_SIZE-1)))
                  + CACHE_LINE_SIZE);
+    gridPtr->cellType = GRID_CELL_LONG;
+    gridPtr->cells = (void*)gridPtr->points;
 
-    gridPtr->locks = (pthread_mutex_t *)((char*)(((unsigned long)gridPtr->locks_unaligned
-                     & ~(CACHE_LINE_SIZE-1)))
-                 + CACHE_LINE_SIZE);
+    gridPtr->locks = NULL;
+    if (gridPtr->locks_unaligned) {
+      gridPtr->locks = (pthread_mutex_t *)((char*)(((unsigned long)gridPtr->locks_unaligned
+                       & ~(CACHE_LINE_SIZE-1)))
+                   + CACHE_LINE_SIZE);
+    }
+
+    /* a fixed table, whatever the size of the board */
+    gridPtr->tileLocks_unaligned = NULL;
+    gridPtr->tileLocks = NULL;
+    if (commit == GRID_COMMIT_TILE) {
+      gridPtr->tileLocks_unaligned = (grid_tilelock_t*)calloc(1, (GRID_TILELOCK_COUNT + 1) * sizeof(grid_tilelock_t));
+      assert(gridPtr->tileLocks_unaligned);
+      gridPtr->tileLocks = (grid_tilelock_t*)((char*)(((unsigned long)gridPtr->tileLocks_unaligned
+                           & ~(GRID_TILELOCK_BYTES-1)))
+                       + GRID_TILELOCK_BYTES);
+    }
+
+    gridPtr->versions = NULL;
+    gridPtr->versionEpochs = NULL;
+    gridPtr->numVersion = 0;
+    if (commit == GRID_COMMIT_VERSION) {
+      gridPtr->numVersion = (n + (1L << GRID_VERSION_BITS) - 1) >> GRID_VERSION_BITS;
+      gridPtr->versions = (unsigned long*)calloc(gridPtr->numVersion, sizeof(unsigned long));
+      assert(gridPtr->versions);
+    }
+    gridPtr->stmPtr = NULL;
+    if (commit == GRID_COMMIT_STM) {
+      gridPtr->stmPtr = stm_alloc();
+      assert(gridPtr->stmPtr);
+    }
+
+    gridPtr->occupancyRowWords = (width + GRID_OCCUPANCY_WORD_BITS - 1) / GRID_OCCUPANCY_WORD_BITS;
+    gridPtr->occupancy = (uint64_t*)calloc((gridPtr->occupancyRowWords * height * depth), sizeof(uint64_t));
+    assert(gridPtr->occupancy);
+
+    gridPtr->epochs = NULL;
+    gridPtr->epoch = 0;
+    gridPtr->basePtr = NULL;
 
     memset(gridPtr->points, GRID_POINT_EMPTY, (n * sizeof(long)));
 
-    for (long i = 0; i < n; i++) {
+    for (long i = 0; gridPtr->locks && i < n; i++) {
       if (Pthread_mutex_init(print_error, "grid_alloc: failed to init mutex", &gridPtr->locks[i], NULL)) {
         for (long j = 0; j < n; j++) 
           Pthread_mutex_destroy(print_error, "grid_alloc: failed to destroy mutex", &gridPtr->locks[j]);
@@ -124,6 +221,150 @@ grid_t* grid_alloc (long width, long height, long depth){
   return gridPtr;
 }
 
+
+/* =============================================================================
+ * grid_parseLayout
+ * -- Returns GRID_LAYOUT_INVALID if the name is unknown
+ * =============================================================================
+ */
+grid_layout_t grid_parseLayout (const char* name){
+  if (strcmp(name, "linear") == 0) {
+    return GRID_LAYOUT_LINEAR;
+  }
+  if (strcmp(name, "tiled") == 0) {
+    return GRID_LAYOUT_TILED;
+  }
+  return GRID_LAYOUT_INVALID;
+}
+
+
+/* =============================================================================
+ * grid_parseCommit
+ * -- Returns GRID_COMMIT_INVALID if the name is unknown
+ * =============================================================================
+ */
+grid_commit_t grid_parseCommit (const char* name){
+  if (strcmp(name, "lock") == 0) {
+    return GRID_COMMIT_LOCK;
+  }
+  if (strcmp(name, "cas") == 0) {
+    return GRID_COMMIT_CAS;
+  }
+  if (strcmp(name, "tile") == 0) {
+    return GRID_COMMIT_TILE;
+  }
+  if (strcmp(name, "version") == 0) {
+    return GRID_COMMIT_VERSION;
+  }
+  if (strcmp(name, "stm") == 0) {
+    return GRID_COMMIT_STM;
+  }
+  return GRID_COMMIT_INVALID;
+}
+
+
+/* =============================================================================
+ * grid_allocPrivate
+ * -- Per-thread grid over basePtr, with cells of the given type and no point
+ *    locks; it must be accessed through grid_getCell and grid_setCell
+ * -- A scratch grid is never copied into: its points are read from basePtr
+ *    until they are first written after grid_resetScratch
+ * =============================================================================
+ */
+grid_t* grid_allocPrivate (grid_t* basePtr, grid_cell_t cellType, bool_t isScratch){
+  grid_t* gridPtr;
+
+  gridPtr = (grid_t*)malloc(sizeof(grid_t));
+  if (gridPtr) {
+    long width = basePtr->width;
+    long height = basePtr->height;
+    long depth = basePtr->depth;
+    gridPtr->width = width;
+    gridPtr->height = height;
+    gridPtr->depth = depth;
+    grid_setWindow(gridPtr, 0, 0, 0, width - 1, height - 1, depth - 1);
+    setLayout(gridPtr, basePtr->layout);
+    long n = gridPtr->numCell;
+
+    gridPtr->cellType = cellType;
+    gridPtr->points_unaligned = (long*)malloc(n * cellSize(cellType) + CACHE_LINE_SIZE);
+    assert(gridPtr->points_unaligned);
+    gridPtr->cells = (void*)((char*)(((unsigned long)gridPtr->points_unaligned
+                     & ~(CACHE_LINE_SIZE-1)))
+                 + CACHE_LINE_SIZE);
+    gridPtr->points = ((cellType == GRID_CELL_LONG) ? (long*)gridPtr->cells : NULL);
+    gridPtr->commit = basePtr->commit;
+    gridPtr->locks_unaligned = NULL;
+    gridPtr->locks = NULL;
+    gridPtr->tileLocks_unaligned = NULL;
+    gridPtr->tileLocks = NULL;
+    gridPtr->occupancy = NULL;
+    gridPtr->occupancyRowWords = 0;
+    gridPtr->basePtr = basePtr;
+
+    if (isScratch) {
+      /* every epoch starts stale: the first reset moves to epoch 1 */
+      gridPtr->epochs = (uint8_t*)calloc(n, sizeof(uint8_t));
+      assert(gridPtr->epochs);
+    } else {
+      gridPtr->epochs = NULL;
+    }
+    gridPtr->epoch = 0;
+
+    /* only reads from basePtr are versioned, so only scratch grids record them */
+    gridPtr->stmPtr = NULL;
+    gridPtr->versions = NULL;
+    gridPtr->versionEpochs = NULL;
+    gridPtr->numVersion = 0;
+    if (isScratch && basePtr->versions) {
+      gridPtr->numVersion = basePtr->numVersion;
+      gridPtr->versions = (unsigned long*)malloc(gridPtr->numVersion * sizeof(unsigned long));
+      assert(gridPtr->versions);
+      gridPtr->versionEpochs = (uint8_t*)calloc(gridPtr->numVersion, sizeof(uint8_t));
+      assert(gridPtr->versionEpochs);
+    }
+  }
+
+  return gridPtr;
+}
+
+
+/* =============================================================================
+ * grid_getCellMax
+ * -- Largest value a cell of the given type holds; the smallest is -(max + 1)
+ * =============================================================================
+ */
+long grid_getCellMax (grid_cell_t cellType){
+  switch (cellType) {
+    case GRID_CELL_INT16:
+      return INT16_MAX;
+    case GRID_CELL_INT32:
+      return INT32_MAX;
+    case GRID_CELL_LONG:
+    default:
+      return LONG_MAX;
+  }
+}
+
+
+/* =============================================================================
+ * grid_resetScratch
+ * -- Forgets everything written since the last reset, in O(1) but when the
+ *    epoch wraps
+ * =============================================================================
+ */
+void grid_resetScratch (grid_t* scratchPtr){
+  assert(scratchPtr->epochs);
+  if (++scratchPtr->epoch == 0) {
+    memset(scratchPtr->epochs, 0, scratchPtr->numCell * sizeof(uint8_t));
+    if (scratchPtr->versionEpochs) {
+      memset(scratchPtr->versionEpochs, 0, scratchPtr->numVersion * sizeof(uint8_t));
+    }
+    scratchPtr->epoch = 1;
+  }
+}
+
+
 /* =============================================================================
  * grid_free
  * =============================================================================
@@ -131,6 +372,14 @@ grid_t* grid_alloc (long width, long height, long depth){
 void grid_free (grid_t* gridPtr){
   free(gridPtr->points_unaligned);
   free(gridPtr->locks_unaligned);
+  free(gridPtr->tileLocks_unaligned);
+  free(gridPtr->occupancy);
+  free(gridPtr->epochs);
+  free(gridPtr->versions);
+  free(gridPtr->versionEpochs);
+  if (gridPtr->stmPtr) {
+    stm_free(gridPtr->stmPtr);
+  }
   free(gridPtr);
 }
 
@@ -139,7 +388,7 @@ void grid_free (grid_t* gridPtr){
  * =============================================================================
  */
 void grid_lockPoint (grid_t* gridPtr, long x, long y, long z){
-  Pthread_mutex_lock(print_error, "grid_lockPoint: failed to lock mutex", &gridPtr->locks[(z * gridPtr->height + y) * gridPtr->width + x]);
+  Pthread_mutex_lock(print_error, "grid_lockPoint: failed to lock mutex", &gridPtr->locks[grid_getPointIndex(gridPtr, x, y, z)]);
 }
 
 /* =============================================================================
@@ -147,7 +396,7 @@ void grid_lockPoint (grid_t* gridPtr, long x, long y, long z){
  * =============================================================================
  */
 int grid_trylockPoint (grid_t* gridPtr, long x, long y, long z){
-  int ret = Pthread_mutex_trylock(ignore, NULL, &gridPtr->locks[(z * gridPtr->height + y) * gridPtr->width + x]);
+  int ret = Pthread_mutex_trylock(ignore, NULL, &gridPtr->locks[grid_getPointIndex(gridPtr, x, y, z)]);
   if (ret != 0 && ret != EBUSY) {
     errno = ret;
     perror("grid_trylockPoint: failed to lock point\n");
@@ -161,7 +410,7 @@ int grid_trylockPoint (grid_t* gridPtr, long x, long y, long z){
  * =============================================================================
  */
 void grid_unlockPoint (grid_t* gridPtr, long x, long y, long z){
-  Pthread_mutex_unlock(print_error, "grid_unlockPoint: failed to unlock mutex", &gridPtr->locks[(z * gridPtr->height + y) * gridPtr->width + x]);
+  Pthread_mutex_unlock(print_error, "grid_unlockPoint: failed to unlock mutex", &gridPtr->locks[grid_getPointIndex(gridPtr, x, y, z)]);
 }
 
 /* =============================================================================
@@ -197,6 +446,39 @@ int grid_trylockPointPtr (grid_t* gridPtr, long *gridPointPtr){
   return ret;
 }
 
+/* =============================================================================
+ * copyCells
+ * -- Copies n points from a long grid, narrowing them to dstGridPtr's cells
+ * =============================================================================
+ */
+static void copyCells (grid_t* dstGridPtr, grid_t* srcGridPtr, long first, long n){
+  assert(srcGridPtr->cellType == GRID_CELL_LONG);
+
+  const long* srcPoints = &srcGridPtr->points[first];
+  long i;
+  switch (dstGridPtr->cellType) {
+    case GRID_CELL_INT16: {
+      int16_t* dstCells = &((int16_t*)dstGridPtr->cells)[first];
+      for (i = 0; i < n; i++) {
+        dstCells[i] = (int16_t)srcPoints[i];
+      }
+      break;
+    }
+    case GRID_CELL_INT32: {
+      int32_t* dstCells = &((int32_t*)dstGridPtr->cells)[first];
+      for (i = 0; i < n; i++) {
+        dstCells[i] = (int32_t)srcPoints[i];
+      }
+      break;
+    }
+    case GRID_CELL_LONG:
+    default:
+      memcpy(&dstGridPtr->points[first], srcPoints, (n * sizeof(long)));
+      break;
+  }
+}
+
+
 /* =============================================================================
  * grid_copy
  * =============================================================================
@@ -206,19 +488,77 @@ void grid_copy (grid_t* dstGridPtr, grid_t* srcGridPtr){
   assert(srcGridPtr->height == dstGridPtr->height);
   assert(srcGridPtr->depth == dstGridPtr->depth);
 
-  long n = srcGridPtr->width * srcGridPtr->height * srcGridPtr->depth;
-  memcpy(dstGridPtr->points, srcGridPtr->points, (n * sizeof(long)));
+  assert(srcGridPtr->layout == dstGridPtr->layout);
+
+  copyCells(dstGridPtr, srcGridPtr, 0, srcGridPtr->numCell);
+}
+
+
+/* =============================================================================
+ * grid_copyWindow
+ * -- Like grid_copy, but only copies the points inside dstGridPtr's window
+ * =============================================================================
+ */
+void grid_copyWindow (grid_t* dstGridPtr, grid_t* srcGridPtr){
+  assert(srcGridPtr->width == dstGridPtr->width);
+  assert(srcGridPtr->height == dstGridPtr->height);
+  assert(srcGridPtr->depth == dstGridPtr->depth);
+  assert(srcGridPtr->layout == dstGridPtr->layout);
+
+  if (dstGridPtr->layout == GRID_LAYOUT_TILED) {
+    /* the window's layers of a brick are contiguous: copy them whole */
+    long numLayer = dstGridPtr->zMax - dstGridPtr->zMin + 1;
+    long tx, ty;
+    for (ty = (dstGridPtr->yMin >> GRID_TILE_BITS); ty <= (dstGridPtr->yMax >> GRID_TILE_BITS); ty++) {
+      for (tx = (dstGridPtr->xMin >> GRID_TILE_BITS); tx <= (dstGridPtr->xMax >> GRID_TILE_BITS); tx++) {
+        copyCells(dstGridPtr, srcGridPtr,
+                  grid_getPointIndex(dstGridPtr, (tx << GRID_TILE_BITS), (ty << GRID_TILE_BITS), dstGridPtr->zMin),
+                  (numLayer * GRID_TILE_SIZE * GRID_TILE_SIZE));
+      }
+    }
+    return;
+  }
+
+  long rowLength = dstGridPtr->xMax - dstGridPtr->xMin + 1;
+  long y, z;
+  for (z = dstGridPtr->zMin; z <= dstGridPtr->zMax; z++) {
+    for (y = dstGridPtr->yMin; y <= dstGridPtr->yMax; y++) {
+      copyCells(dstGridPtr, srcGridPtr,
+                grid_getPointIndex(dstGridPtr, dstGridPtr->xMin, y, z), rowLength);
+    }
+  }
+}
+
+
+/* =============================================================================
+ * grid_setWindow
+ * -- Restricts the points seen as valid to the given box (clamped to the grid)
+ * -- Returns TRUE if the resulting window is the whole grid
+ * =============================================================================
+ */
+bool_t grid_setWindow (grid_t* gridPtr, long xMin, long yMin, long zMin, long xMax, long yMax, long zMax){
+  gridPtr->xMin = MAX(xMin, 0);
+  gridPtr->yMin = MAX(yMin, 0);
+  gridPtr->zMin = MAX(zMin, 0);
+  gridPtr->xMax = MIN(xMax, gridPtr->width - 1);
+  gridPtr->yMax = MIN(yMax, gridPtr->height - 1);
+  gridPtr->zMax = MIN(zMax, gridPtr->depth - 1);
+
+  return ((gridPtr->xMin == 0 && gridPtr->xMax == gridPtr->width - 1 &&
+           gridPtr->yMin == 0 && gridPtr->yMax == gridPtr->height - 1 &&
+           gridPtr->zMin == 0 && gridPtr->zMax == gridPtr->depth - 1) ? TRUE : FALSE);
 }
 
 
 /* =============================================================================
  * grid_isPointValid
+ * -- Only points inside the grid's window are valid
  * =============================================================================
  */
 bool_t grid_isPointValid (grid_t* gridPtr, long x, long y, long z){
-  if (x < 0 || x >= gridPtr->width ||
-    y < 0 || y >= gridPtr->height ||
-    z < 0 || z >= gridPtr->depth)
+  if (x < gridPtr->xMin || x > gridPtr->xMax ||
+    y < gridPtr->yMin || y > gridPtr->yMax ||
+    z < gridPtr->zMin || z > gridPtr->zMax)
   {
     return FALSE;
   }
@@ -232,7 +572,36 @@ bool_t grid_isPointValid (grid_t* gridPtr, long x, long y, long z){
  * =============================================================================
  */
 long* grid_getPointRef (grid_t* gridPtr, long x, long y, long z){
-  return &(gridPtr->points[(z * gridPtr->height + y) * gridPtr->width + x]);
+  return &(gridPtr->points[grid_getPointIndex(gridPtr, x, y, z)]);
+}
+
+
+/* =============================================================================
+ * grid_getPointIndex
+ * -- Index of (x, y, z) in the grid's storage, whatever its layout
+ * -- Tiled: bricks are stored row-major, each as depth layers of
+ *    GRID_TILE_SIZE rows of GRID_TILE_SIZE points, so the neighbors of a
+ *    point in y and z are GRID_TILE_SIZE and GRID_TILE_SIZE^2 points away
+ *    rather than a whole row or layer
+ * =============================================================================
+ */
+long grid_getPointIndex (grid_t* gridPtr, long x, long y, long z){
+  if (gridPtr->layout == GRID_LAYOUT_TILED) {
+    long tile = (y >> GRID_TILE_BITS) * gridPtr->tilesX + (x >> GRID_TILE_BITS);
+    return ((((tile * gridPtr->depth + z) << GRID_TILE_BITS | (y & GRID_TILE_MASK))
+             << GRID_TILE_BITS) | (x & GRID_TILE_MASK));
+  }
+  return ((z * gridPtr->height + y) * gridPtr->width + x);
+}
+
+
+/* =============================================================================
+ * grid_getOccupancyRow
+ * -- Occupancy words of row (y, z); bit i of word w is x = w * 64 + i
+ * =============================================================================
+ */
+const uint64_t* grid_getOccupancyRow (grid_t* gridPtr, long y, long z){
+  return &gridPtr->occupancy[(z * gridPtr->height + y) * gridPtr->occupancyRowWords];
 }
 
 
@@ -241,6 +610,16 @@ long* grid_getPointRef (grid_t* gridPtr, long x, long y, long z){
  * =============================================================================
  */
 void grid_getPointIndices (grid_t* gridPtr, long* gridPointPtr, long* xPtr, long* yPtr, long* zPtr){
+  if (gridPtr->layout == GRID_LAYOUT_TILED) {
+    long index = (gridPointPtr - gridPtr->points);
+    long layer = index >> (2 * GRID_TILE_BITS);
+    long tile = layer / gridPtr->depth;
+    (*zPtr) = layer % gridPtr->depth;
+    (*yPtr) = ((tile / gridPtr->tilesX) << GRID_TILE_BITS) | ((index >> GRID_TILE_BITS) & GRID_TILE_MASK);
+    (*xPtr) = ((tile % gridPtr->tilesX) << GRID_TILE_BITS) | (index & GRID_TILE_MASK);
+    return;
+  }
+
   long height = gridPtr->height;
   long width = gridPtr->width;
   long area = height * width;
@@ -287,6 +666,15 @@ bool_t grid_isPointFull (grid_t* gridPtr, long x, long y, long z){
  */
 void grid_setPoint (grid_t* gridPtr, long x, long y, long z, long value){
   (*grid_getPointRef(gridPtr, x, y, z)) = value;
+  if (gridPtr->occupancy) {
+    uint64_t* wordPtr = occupancyWordRef(gridPtr, x, y, z);
+    uint64_t bit = occupancyBit(x);
+    if (value == GRID_POINT_FULL) {
+      (*wordPtr) |= bit;
+    } else {
+      (*wordPtr) &= ~bit;
+    }
+  }
 }
 
 /* =============================================================================
@@ -320,18 +708,122 @@ void grid_addPath (grid_t* gridPtr, vector_t* pointVectorPtr){
 }
 
 
+/* =============================================================================
+ * getTileLockSlot
+ * -- Slot in the tile lock table of the 8x8x1 tile of a point
+ * =============================================================================
+ */
+static long getTileLockSlot (grid_t* gridPtr, long* gridPointPtr){
+  long x;
+  long y;
+  long z;
+  grid_getPointIndices(gridPtr, gridPointPtr, &x, &y, &z);
+  long tileCols = (gridPtr->width + GRID_TILE_SIZE - 1) >> GRID_TILE_BITS;
+  long tileRows = (gridPtr->height + GRID_TILE_SIZE - 1) >> GRID_TILE_BITS;
+  long tile = ((z * tileRows + (y >> GRID_TILE_BITS)) * tileCols) + (x >> GRID_TILE_BITS);
+  return (tile & (GRID_TILELOCK_COUNT - 1));
+}
+
+
+/* =============================================================================
+ * grid_claim_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+grid_claim_t* grid_claim_alloc (void){
+  grid_claim_t* claimPtr = (grid_claim_t*)malloc(sizeof(grid_claim_t));
+  if (claimPtr) {
+    claimPtr->slots = NULL;
+    claimPtr->numSlot = 0;
+    claimPtr->capacity = 0;
+    stm_txInit(&claimPtr->tx);
+  }
+
+  return claimPtr;
+}
+
+
+/* =============================================================================
+ * grid_claim_free
+ * =============================================================================
+ */
+void grid_claim_free (grid_claim_t* claimPtr){
+  stm_txFree(&claimPtr->tx);
+  free(claimPtr->slots);
+  free(claimPtr);
+}
+
+
+/* =============================================================================
+ * claimInsert
+ * -- Adds a slot to the ascending, duplicate-free list of the claim
+ * =============================================================================
+ */
+static void claimInsert (grid_claim_t* claimPtr, long slot){
+  long lo = 0;
+  long hi = claimPtr->numSlot;
+  while (lo < hi) {
+    long mid = (lo + hi) / 2;
+    if (claimPtr->slots[mid] < slot) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < claimPtr->numSlot && claimPtr->slots[lo] == slot) {
+    return;
+  }
+  if (claimPtr->numSlot == claimPtr->capacity) {
+    claimPtr->capacity = ((claimPtr->capacity > 0) ? (2 * claimPtr->capacity) : 64);
+    claimPtr->slots = (long*)realloc(claimPtr->slots, claimPtr->capacity * sizeof(long));
+    assert(claimPtr->slots);
+  }
+  memmove(&claimPtr->slots[lo + 1], &claimPtr->slots[lo], (claimPtr->numSlot - lo) * sizeof(long));
+  claimPtr->slots[lo] = slot;
+  claimPtr->numSlot++;
+}
+
+
 /* =============================================================================
  * grid_addPath_Ptr
+ * -- Commits a path whose points grid_checkPath_Ptr claimed into claimPtr
  * =============================================================================
  */
-void grid_addPath_Ptr (grid_t* gridPtr, vector_t* pointVectorPtr){
+void grid_addPath_Ptr (grid_t* gridPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr){
   long i;
   long n = vector_getSize(pointVectorPtr);
 
   for (i = 1; i < (n-1); i++) {
     long* gridPointPtr = (long*)vector_at(pointVectorPtr, i);
-    *gridPointPtr = GRID_POINT_FULL; 
-    grid_unlockPointPtr(gridPtr, gridPointPtr);
+    long x;
+    long y;
+    long z;
+    grid_getPointIndices(gridPtr, gridPointPtr, &x, &y, &z);
+    /* other threads may be committing points that share the word */
+    __atomic_fetch_or(occupancyWordRef(gridPtr, x, y, z), occupancyBit(x), __ATOMIC_RELAXED);
+    if (gridPtr->commit == GRID_COMMIT_LOCK) {
+      *gridPointPtr = GRID_POINT_FULL;
+      grid_unlockPointPtr(gridPtr, gridPointPtr);
+    } else if (gridPtr->commit == GRID_COMMIT_TILE || gridPtr->commit == GRID_COMMIT_VERSION) {
+      *gridPointPtr = GRID_POINT_FULL;
+    }
+  }
+
+  /* each block held goes from odd to the next even version, once */
+  if (gridPtr->commit == GRID_COMMIT_VERSION) {
+    for (i = 0; i < claimPtr->numSlot; i++) {
+      unsigned long* versionPtr = &gridPtr->versions[claimPtr->slots[i]];
+      __atomic_store_n(versionPtr, (*versionPtr + 1), __ATOMIC_RELEASE);
+    }
+    claimPtr->numSlot = 0;
+  }
+
+  /* every point written: each tile lock held is let go, once */
+  if (gridPtr->commit == GRID_COMMIT_TILE) {
+    for (i = 0; i < claimPtr->numSlot; i++) {
+      __atomic_store_n(&gridPtr->tileLocks[claimPtr->slots[i]].isHeld, 0, __ATOMIC_RELEASE);
+    }
+    claimPtr->numSlot = 0;
   }
 }
 
@@ -342,53 +834,339 @@ void grid_addPath_Ptr (grid_t* gridPtr, vector_t* pointVectorPtr){
 static int compare_positions(const void * a, const void *b) 
 {
   /* this works ou quite nicely, because of the way the grid is mapped to mem */
-  /* this orders points (a.x, a.y, a.z) and (b.x, b.y, b.z) with the predicate
+  /* with the linear layout, this orders points (a.x, a.y, a.z) and (b.x, b.y, b.z) with the predicate
    *
    * a < b iff
    * a.z < b.z || (a.z == b.z && a.y < b.y) || (a.z == b.z && a.y == b.y && a.x < b.x)
+   *
+   * with the tiled one it is brick order instead: any total order will do
+   * to take the locks without deadlocking
    */
   return (int) (((const unsigned long *) a)  - ((const unsigned long *) b));
 }
 
 
 /* =============================================================================
- * grid_checkPath_Ptr
+ * claimPath
+ * -- GRID_COMMIT_CAS: every point goes from empty to full in a single CAS,
+ *    so there is no lock to wait for and no order to take them in; on a
+ *    taken point, the ones already claimed are put back
+ * -- A point claimed reads as full at once, although the claim may yet be
+ *    undone: an expansion meanwhile at worst routes around it
+ * =============================================================================
+ */
+static bool_t claimPath (grid_t* gridPtr, vector_t* pointVectorPtr){
+  long i;
+  long n = vector_getSize(pointVectorPtr);
+
+  for (i = 1; i < (n-1); i++) {
+    long* gridPointPtr = (long*)vector_at(pointVectorPtr, i);
+    long expected = GRID_POINT_EMPTY;
+    if (!__atomic_compare_exchange_n(gridPointPtr, &expected, GRID_POINT_FULL,
+                                     FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      long j;
+      for (j = 1; j < i; j++) {
+        __atomic_store_n((long*)vector_at(pointVectorPtr, j), GRID_POINT_EMPTY, __ATOMIC_RELEASE);
+      }
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * lockPathTiles
+ * -- GRID_COMMIT_TILE: takes the locks of the distinct tiles of the path in
+ *    slot order, so two commits never wait on each other in a cycle, and
+ *    keeps them (listed in claimPtr, until grid_addPath_Ptr) only if every
+ *    point is empty; one busy for longer than the contention manager allows
+ *    makes it let go of the others and start over
+ * =============================================================================
+ */
+static bool_t lockPathTiles (grid_t* gridPtr, contention_t* contentionPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr){
+  long i;
+  long n = vector_getSize(pointVectorPtr);
+  claimPtr->numSlot = 0;
+  if (n <= 2) {
+    return TRUE;
+  }
+
+  /* consecutive points mostly share a tile */
+  long lastSlot = -1;
+  for (i = 1; i < (n-1); i++) {
+    long slot = getTileLockSlot(gridPtr, (long*)vector_at(pointVectorPtr, i));
+    if (slot != lastSlot) {
+      claimInsert(claimPtr, slot);
+      lastSlot = slot;
+    }
+  }
+  long* slots = claimPtr->slots;
+  long numSlot = claimPtr->numSlot;
+
+  long numLocked;
+  long numRerun = 0;
+  while (1) {
+    for (numLocked = 0; numLocked < numSlot; numLocked++) {
+      grid_tilelock_t* lockPtr = &gridPtr->tileLocks[slots[numLocked]];
+      long numPoll = 0;
+      bool_t isGivenUp = FALSE;
+      while (__atomic_load_n(&lockPtr->isHeld, __ATOMIC_RELAXED) ||
+             __atomic_exchange_n(&lockPtr->isHeld, 1, __ATOMIC_ACQUIRE))
+      {
+        if (!contention_wait(contentionPtr, ++numPoll)) {
+          isGivenUp = TRUE;
+          break;
+        }
+      }
+      if (isGivenUp) {
+        break;
+      }
+    }
+    if (numLocked == numSlot) {
+      break;
+    }
+    for (i = 0; i < numLocked; i++) {
+      __atomic_store_n(&gridPtr->tileLocks[slots[i]].isHeld, 0, __ATOMIC_RELEASE);
+    }
+    contention_abort(contentionPtr, ++numRerun);
+  }
+
+  bool_t isEmpty = TRUE;
+  for (i = 1; i < (n-1); i++) {
+    if (*(long*)vector_at(pointVectorPtr, i) == GRID_POINT_FULL) {
+      isEmpty = FALSE;
+      break;
+    }
+  }
+  if (!isEmpty) {
+    for (i = 0; i < numSlot; i++) {
+      __atomic_store_n(&gridPtr->tileLocks[slots[i]].isHeld, 0, __ATOMIC_RELEASE);
+    }
+    claimPtr->numSlot = 0;
+  }
+
+  return isEmpty;
+}
+
+
+/* =============================================================================
+ * lockPathVersions
+ * -- GRID_COMMIT_VERSION: makes the version of every distinct block of the
+ *    path odd, in block order, which holds off other commits (and tells
+ *    readers the block is changing); a block still at the version the
+ *    reader saw has not changed since, so only the points of the others are
+ *    checked, and the versions are put back unchanged if one is taken. A
+ *    block held for longer than the contention manager allows makes it put
+ *    back the others and start over
+ * -- The blocks held are listed in claimPtr, until grid_addPath_Ptr
  * =============================================================================
  */
-bool_t grid_checkPath_Ptr(grid_t* gridPtr, vector_t* pointVectorPtr){
+static bool_t lockPathVersions (grid_t* gridPtr, grid_t* readerPtr, contention_t* contentionPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr){
   long i;
   long n = vector_getSize(pointVectorPtr);
+  claimPtr->numSlot = 0;
+  if (n <= 2) {
+    return TRUE;
+  }
+
+  long lastBlock = -1;
+  for (i = 1; i < (n-1); i++) {
+    long block = ((long*)vector_at(pointVectorPtr, i) - gridPtr->points) >> GRID_VERSION_BITS;
+    if (block != lastBlock) {
+      claimInsert(claimPtr, block);
+      lastBlock = block;
+    }
+  }
+  long* blocks = claimPtr->slots;
+  long numBlock = claimPtr->numSlot;
+
+  long numLocked;
+  long numRerun = 0;
+  while (1) {
+    for (numLocked = 0; numLocked < numBlock; numLocked++) {
+      unsigned long* versionPtr = &gridPtr->versions[blocks[numLocked]];
+      long numPoll = 0;
+      bool_t isGivenUp = FALSE;
+      while (1) {
+        unsigned long version = __atomic_load_n(versionPtr, __ATOMIC_RELAXED);
+        if (!(version & 1) &&
+            __atomic_compare_exchange_n(versionPtr, &version, (version + 1),
+                                        FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+          break;
+        }
+        if (!contention_wait(contentionPtr, ++numPoll)) {
+          isGivenUp = TRUE;
+          break;
+        }
+      }
+      if (isGivenUp) {
+        break;
+      }
+    }
+    if (numLocked == numBlock) {
+      break;
+    }
+    for (i = 0; i < numLocked; i++) {
+      __atomic_store_n(&gridPtr->versions[blocks[i]], (gridPtr->versions[blocks[i]] - 1), __ATOMIC_RELEASE);
+    }
+    contention_abort(contentionPtr, ++numRerun);
+  }
+
+  bool_t isEmpty = TRUE;
+  for (i = 1; i < (n-1); i++) {
+    long* gridPointPtr = (long*)vector_at(pointVectorPtr, i);
+    long block = (gridPointPtr - gridPtr->points) >> GRID_VERSION_BITS;
+    bool_t isUnchanged = (readerPtr && readerPtr->versions &&
+                          readerPtr->versionEpochs[block] == readerPtr->epoch &&
+                          readerPtr->versions[block] + 1 == gridPtr->versions[block]);
+    if (!isUnchanged && *gridPointPtr == GRID_POINT_FULL) {
+      isEmpty = FALSE;
+      break;
+    }
+  }
+  if (!isEmpty) {
+    for (i = 0; i < numBlock; i++) {
+      __atomic_store_n(&gridPtr->versions[blocks[i]], (gridPtr->versions[blocks[i]] - 1), __ATOMIC_RELEASE);
+    }
+    claimPtr->numSlot = 0;
+  }
+
+  return isEmpty;
+}
+
+
+/* =============================================================================
+ * commitPathTransaction
+ * -- GRID_COMMIT_STM: a single transaction reads every point of the path
+ *    and, only if all are empty, writes them all full; it is rerun for as
+ *    long as it aborts, so the path is either committed or found taken
+ * -- The transaction is the one kept in claimPtr
+ * =============================================================================
+ */
+static bool_t commitPathTransaction (grid_t* gridPtr, contention_t* contentionPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr){
+  long i;
+  long n = vector_getSize(pointVectorPtr);
+  if (n <= 2) {
+    return TRUE;
+  }
+
+  stm_tx_t* txPtr = &claimPtr->tx;
+  if (!stm_txReserve(txPtr, gridPtr->stmPtr, (n - 2), contentionPtr)) {
+    perror("commitPathTransaction: failed to grow transaction\n");
+    exit(-4);
+  }
+
+  bool_t isEmpty;
+  while (1) {
+    stm_txBegin(txPtr);
+    isEmpty = TRUE;
+    bool_t isValid = TRUE;
+    for (i = 1; i < (n-1); i++) {
+      long value;
+      if (!stm_txRead(txPtr, (long*)vector_at(pointVectorPtr, i), &value)) {
+        isValid = FALSE;
+        break;
+      }
+      if (value == GRID_POINT_FULL) {
+        isEmpty = FALSE;
+        break;
+      }
+    }
+    if (!isValid) {
+      stm_txAbort(txPtr);
+      continue;
+    }
+    if (!isEmpty) {
+      break;
+    }
+    for (i = 1; i < (n-1); i++) {
+      stm_txWrite(txPtr, (long*)vector_at(pointVectorPtr, i), GRID_POINT_FULL);
+    }
+    if (stm_txCommit(txPtr)) {
+      break;
+    }
+  }
+
+  return isEmpty;
+}
+
+
+/* =============================================================================
+ * lockPathPoints
+ * -- GRID_COMMIT_LOCK: trylocks the points in address order, waiting on a
+ *    busy one for as long as the contention manager allows; past that, the
+ *    points locked so far are let go (no commit waits holding any) and the
+ *    same path is tried again once the manager has backed it off
+ * -- Returns FALSE, with no point locked, only if a point is already FULL
+ * =============================================================================
+ */
+static bool_t lockPathPoints (grid_t* gridPtr, contention_t* contentionPtr, vector_t* pointVectorPtr){
+  long i;
+  long j;
+  long n = vector_getSize(pointVectorPtr);
+  long numRerun = 0;
 
   vector_rangeSort(pointVectorPtr, 1, n - 1, compare_positions);
   for (i = 1; i < (n-1); i++) {
     long* gridPointPtr = (long*)vector_at(pointVectorPtr, i);
 
-    int tries = 1;
+    long numPoll = 0;
     int ret = grid_trylockPointPtr(gridPtr, gridPointPtr); 
-    while (ret == EBUSY && tries < MAX_TRIES) {
-      tries++;
+    while (ret == EBUSY && contention_wait(contentionPtr, ++numPoll)) {
       ret = grid_trylockPointPtr(gridPtr, gridPointPtr); 
-      struct timespec req;
-      req.tv_sec = 0;
-      req.tv_nsec = random() % MAX_TIMEOUT;
-      if (nanosleep(&req, NULL)) {
-        perror("grid_checkGrid: nanosleep");
-        exit(-1);
-      }
     }
-    
+
     if (ret == EBUSY || *gridPointPtr == GRID_POINT_FULL) {
-      int last_locked = (ret == EBUSY) ? i - 1 : i;
-      for (int j = 1; j <= last_locked; j++) {
-        long* gridPointPtr = (long*)vector_at(pointVectorPtr, j);
-        grid_unlockPointPtr(gridPtr, gridPointPtr);
+      long numLocked = ((ret == EBUSY) ? (i - 1) : i);
+      for (j = 1; j <= numLocked; j++) {
+        grid_unlockPointPtr(gridPtr, (long*)vector_at(pointVectorPtr, j));
       }
-      return FALSE;
+      if (ret != EBUSY) {
+        return FALSE;
+      }
+      contention_abort(contentionPtr, ++numRerun);
+      i = 0; /* start over */
     }
   }
 
   return TRUE;
+}
+
+
+/* =============================================================================
+ * grid_checkPath_Ptr
+ * -- GRID_COMMIT_VERSION: readerPtr is the scratch grid the path was found
+ *    on; points in blocks still at the version it read need no check
+ * =============================================================================
+ */
+bool_t grid_checkPath_Ptr(grid_t* gridPtr, grid_t* readerPtr, contention_t* contentionPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr){
+  bool_t isClaimed;
+
+  assert(gridPtr->commit != GRID_COMMIT_NONE);
+  contention_beginCommit(contentionPtr);
+  switch (gridPtr->commit) {
+    case GRID_COMMIT_CAS:
+      isClaimed = claimPath(gridPtr, pointVectorPtr);
+      break;
+    case GRID_COMMIT_TILE:
+      isClaimed = lockPathTiles(gridPtr, contentionPtr, claimPtr, pointVectorPtr);
+      break;
+    case GRID_COMMIT_VERSION:
+      isClaimed = lockPathVersions(gridPtr, readerPtr, contentionPtr, claimPtr, pointVectorPtr);
+      break;
+    case GRID_COMMIT_STM:
+      isClaimed = commitPathTransaction(gridPtr, contentionPtr, claimPtr, pointVectorPtr);
+      break;
+    case GRID_COMMIT_LOCK:
+    default:
+      isClaimed = lockPathPoints(gridPtr, contentionPtr, pointVectorPtr);
+      break;
+  }
+  contention_endCommit(contentionPtr);
 
+  return isClaimed;
 }
 
 /* =============================================================================
@@ -55,21 +55,95 @@
 #define GRID_H 1
 
 
+#include "contention.h"
+#include "stm.h"
 #include "lib/types.h"
 #include "lib/vector.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <pthread.h>
 
+typedef enum grid_cell {
+  GRID_CELL_LONG = 0,  /* 8 bytes per point */
+  GRID_CELL_INT32,     /* private grids only */
+  GRID_CELL_INT16,     /* private grids only */
+} grid_cell_t;
+
+typedef enum grid_layout {
+  GRID_LAYOUT_LINEAR = 0, /* row-major: x, then y, then z */
+  GRID_LAYOUT_TILED,      /* bricks of GRID_TILE_SIZE x GRID_TILE_SIZE x depth */
+  GRID_LAYOUT_INVALID
+} grid_layout_t;
+
+typedef enum grid_commit {
+  GRID_COMMIT_LOCK = 0,   /* a mutex per point, trylocked in order with random backoff */
+  GRID_COMMIT_CAS,        /* each point CASed from empty to full, undone on conflict; no mutexes */
+  GRID_COMMIT_TILE,       /* spinlocks per 8x8x1 tile, from a fixed table, taken in order */
+  GRID_COMMIT_VERSION,    /* seqlock-style versions per block of points, checked against the ones read */
+  GRID_COMMIT_STM,        /* a TL2-style transaction over the path's points (stm.h), rerun on abort */
+  GRID_COMMIT_NONE,       /* single-threaded use only: no claims, paths written with grid_addPath */
+  GRID_COMMIT_INVALID
+} grid_commit_t;
+
+enum grid_tilelock_config {
+  GRID_TILELOCK_COUNT = 4096, /* power of 2: tiles beyond share slots */
+  GRID_TILELOCK_BYTES = 64,   /* one lock per cache line */
+};
+
+typedef struct grid_tilelock {
+  int isHeld;
+  char pad[GRID_TILELOCK_BYTES - sizeof(int)];
+} grid_tilelock_t;
+
+#define GRID_TILE_BITS 3
+#define GRID_TILE_SIZE (1L << GRID_TILE_BITS)
+#define GRID_TILE_MASK (GRID_TILE_SIZE - 1)
+
+/* points per version block: an 8x8 brick layer when tiled, a run of a row
+ * (or two) when linear */
+#define GRID_VERSION_BITS 6
+
 typedef struct grid {
   long width;
   long height;
   long depth;
-  long* points;
+  grid_layout_t layout;
+  long tilesX;         /* bricks per row of bricks (tiled layout only) */
+  long numCell;        /* points stored, bricks padding the edges included */
+  long xMin, xMax; /* window seen by grid_isPointValid (inclusive bounds) */
+  long yMin, yMax;
+  long zMin, zMax;
+  long* points;        /* NULL on narrow private grids */
   long* points_unaligned;
+  grid_cell_t cellType;
+  void* cells;         /* storage of the points, whatever the cell type */
+  grid_commit_t commit;
   pthread_mutex_t *locks_unaligned;
-  pthread_mutex_t *locks;
-
+  pthread_mutex_t *locks; /* GRID_COMMIT_LOCK only (NULL otherwise) */
+  grid_tilelock_t* tileLocks_unaligned;
+  grid_tilelock_t* tileLocks; /* GRID_COMMIT_TILE only (NULL otherwise) */
+
+  /* GRID_COMMIT_VERSION only (NULL otherwise): on the shared grid, a
+   * version per block, odd while a commit writes to it; on a scratch grid,
+   * the version each block was first read at for the current net, if its
+   * entry in versionEpochs is the current epoch */
+  unsigned long* versions;
+  uint8_t* versionEpochs;
+  long numVersion;
+  stm_t* stmPtr;       /* GRID_COMMIT_STM only (NULL otherwise) */
+
+  /* one bit per point, set iff it is GRID_POINT_FULL; each (y, z) row of x
+   * starts on a new word (NULL on private grids) */
+  uint64_t* occupancy;
+  long occupancyRowWords;
+
+  /* scratch grids only (NULL otherwise): a point whose epoch is stale
+   * has not been written for the current net and reads as basePtr's; a
+   * byte per point, so every 255 nets the epochs wrap and are cleared */
+  uint8_t* epochs;
+  uint8_t epoch;
+  struct grid* basePtr;
 } grid_t;
 
 enum {
@@ -77,12 +151,70 @@ enum {
   GRID_POINT_EMPTY = -1L
 };
 
+#define GRID_OCCUPANCY_WORD_BITS 64
+
+/* what a thread's grid_checkPath_Ptr holds until its grid_addPath_Ptr:
+ * the distinct tile lock slots (or version blocks) of the path, ascending,
+ * so each is released exactly once; reused from path to path, as is the
+ * thread's transaction for GRID_COMMIT_STM */
+typedef struct grid_claim {
+  long* slots;
+  long numSlot;
+  long capacity;
+  stm_tx_t tx;
+} grid_claim_t;
+
 
 /* =============================================================================
  * grid_alloc
+ * -- The commit mode picks how grid_checkPath_Ptr claims points;
+ *    GRID_COMMIT_NONE grids allocate nothing for it and cannot claim
+ * =============================================================================
+ */
+grid_t* grid_alloc (long width, long height, long depth, grid_layout_t layout, grid_commit_t commit);
+
+
+/* =============================================================================
+ * grid_parseLayout
+ * -- Returns GRID_LAYOUT_INVALID if the name is unknown
+ * =============================================================================
+ */
+grid_layout_t grid_parseLayout (const char* name);
+
+
+/* =============================================================================
+ * grid_parseCommit
+ * -- Returns GRID_COMMIT_INVALID if the name is unknown
  * =============================================================================
  */
-grid_t* grid_alloc (long width, long height, long depth);
+grid_commit_t grid_parseCommit (const char* name);
+
+
+/* =============================================================================
+ * grid_allocPrivate
+ * -- Per-thread grid over basePtr, with cells of the given type and no point
+ *    locks; it must be accessed through grid_getCell and grid_setCell
+ * -- A scratch grid is never copied into: its points are read from basePtr
+ *    until they are first written after grid_resetScratch
+ * =============================================================================
+ */
+grid_t* grid_allocPrivate (grid_t* basePtr, grid_cell_t cellType, bool_t isScratch);
+
+
+/* =============================================================================
+ * grid_getCellMax
+ * -- Largest value a cell of the given type holds; the smallest is -(max + 1)
+ * =============================================================================
+ */
+long grid_getCellMax (grid_cell_t cellType);
+
+
+/* =============================================================================
+ * grid_resetScratch
+ * -- Forgets everything written since the last reset, in O(1)
+ * =============================================================================
+ */
+void grid_resetScratch (grid_t* scratchPtr);
 
 
 /* =============================================================================
@@ -99,8 +231,26 @@ void grid_free (grid_t* gridPtr);
 void grid_copy (grid_t* dstGridPtr, grid_t* srcGridPtr);
 
 
+/* =============================================================================
+ * grid_copyWindow
+ * -- Like grid_copy, but only copies the points inside dstGridPtr's window
+ * =============================================================================
+ */
+void grid_copyWindow (grid_t* dstGridPtr, grid_t* srcGridPtr);
+
+
+/* =============================================================================
+ * grid_setWindow
+ * -- Restricts the points seen as valid to the given box (clamped to the grid)
+ * -- Returns TRUE if the resulting window is the whole grid
+ * =============================================================================
+ */
+bool_t grid_setWindow (grid_t* gridPtr, long xMin, long yMin, long zMin, long xMax, long yMax, long zMax);
+
+
 /* =============================================================================
  * grid_isPointValid
+ * -- Only points inside the grid's window are valid
  * =============================================================================
  */
 bool_t grid_isPointValid (grid_t* gridPtr, long x, long y, long z);
@@ -113,6 +263,91 @@ bool_t grid_isPointValid (grid_t* gridPtr, long x, long y, long z);
 long* grid_getPointRef (grid_t* gridPtr, long x, long y, long z);
 
 
+/* =============================================================================
+ * grid_getPointIndex
+ * -- Index of (x, y, z) in the grid's storage, whatever its layout
+ * =============================================================================
+ */
+long grid_getPointIndex (grid_t* gridPtr, long x, long y, long z);
+
+
+/* =============================================================================
+ * grid_recordVersion
+ * -- The first read of a block for the current net keeps the version it was
+ *    at, taken before any of its points is read
+ * =============================================================================
+ */
+static inline void grid_recordVersion (grid_t* scratchPtr, long index){
+  long block = index >> GRID_VERSION_BITS;
+  if (scratchPtr->versionEpochs[block] != scratchPtr->epoch) {
+    scratchPtr->versionEpochs[block] = scratchPtr->epoch;
+    scratchPtr->versions[block] = __atomic_load_n(&scratchPtr->basePtr->versions[block], __ATOMIC_ACQUIRE);
+  }
+}
+
+
+/* =============================================================================
+ * grid_getCell
+ * -- Value of the point at an index, for any grid
+ * -- Inline: the expansion engines read every label through it
+ * =============================================================================
+ */
+static inline long grid_getCell (grid_t* gridPtr, long index){
+  if (gridPtr->epochs && gridPtr->epochs[index] != gridPtr->epoch) {
+    /* not written for this net yet */
+    if (gridPtr->versions) {
+      grid_recordVersion(gridPtr, index);
+    }
+    return gridPtr->basePtr->points[index];
+  }
+
+  switch (gridPtr->cellType) {
+    case GRID_CELL_INT16:
+      return ((int16_t*)gridPtr->cells)[index];
+    case GRID_CELL_INT32:
+      return ((int32_t*)gridPtr->cells)[index];
+    case GRID_CELL_LONG:
+    default:
+      return gridPtr->points[index];
+  }
+}
+
+
+/* =============================================================================
+ * grid_setCell
+ * -- Value must fit the grid's cell type (selected for the largest label
+ *    the router can write, so it is not checked here)
+ * -- Inline: the expansion engines write every label through it
+ * =============================================================================
+ */
+static inline void grid_setCell (grid_t* gridPtr, long index, long value){
+  if (gridPtr->epochs) {
+    gridPtr->epochs[index] = gridPtr->epoch;
+  }
+
+  switch (gridPtr->cellType) {
+    case GRID_CELL_INT16:
+      ((int16_t*)gridPtr->cells)[index] = (int16_t)value;
+      break;
+    case GRID_CELL_INT32:
+      ((int32_t*)gridPtr->cells)[index] = (int32_t)value;
+      break;
+    case GRID_CELL_LONG:
+    default:
+      gridPtr->points[index] = value;
+      break;
+  }
+}
+
+
+/* =============================================================================
+ * grid_getOccupancyRow
+ * -- Occupancy words of row (y, z); bit i of word w is x = w * 64 + i
+ * =============================================================================
+ */
+const uint64_t* grid_getOccupancyRow (grid_t* gridPtr, long y, long z);
+
+
 /* =============================================================================
  * grid_getPointIndices
  * =============================================================================
@@ -162,18 +397,41 @@ long grid_distToEdge (grid_t* gridPtr, long x, long y, long z);
 void grid_addPath (grid_t* gridPtr, vector_t* pointVectorPtr);
 
 
+/* =============================================================================
+ * grid_claim_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+grid_claim_t* grid_claim_alloc (void);
+
+
+/* =============================================================================
+ * grid_claim_free
+ * =============================================================================
+ */
+void grid_claim_free (grid_claim_t* claimPtr);
+
+
 /* =============================================================================
  * grid_addPath_Ptr
+ * -- Commits a path whose points grid_checkPath_Ptr claimed into claimPtr
  * =============================================================================
  */
-void grid_addPath_Ptr (grid_t* gridPtr, vector_t* pointVectorPtr);
+void grid_addPath_Ptr (grid_t* gridPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr);
 
 
 /* =============================================================================
  * grid_checkPath_Ptr
+ * -- Claims the points of a path (a vector of grid point pointers, its
+ *    ends excluded) for grid_addPath_Ptr; claimPtr is the calling thread's
+ * -- GRID_COMMIT_VERSION: readerPtr is the scratch grid the path was found
+ *    on; points in blocks still at the version it read need no check
+ * -- Busy points are waited on, or let go of and tried again, as
+ *    contentionPtr (the calling thread's) decides
+ * -- Returns FALSE, claiming none, if some point is already taken
  * =============================================================================
  */
-bool_t grid_checkPath_Ptr (grid_t* gridPtr, vector_t* pointVectorPtr);
+bool_t grid_checkPath_Ptr (grid_t* gridPtr, grid_t* readerPtr, contention_t* contentionPtr, grid_claim_t* claimPtr, vector_t* pointVectorPtr);
 
 /* =============================================================================
  * grid_print (derived from grid print to file)
@@ -54,14 +54,17 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "coordinate.h"
 #include "grid.h"
 #include "lib/list.h"
 #include "maze.h"
+#include "path.h"
 #include "lib/queue.h"
 #include "lib/pair.h"
 #include "lib/types.h"
+#include "lib/utility.h"
 #include "lib/vector.h"
 
 /* =============================================================================
@@ -78,6 +81,10 @@ maze_t* maze_alloc (){
     mazePtr->wallVectorPtr = vector_alloc(1);
     mazePtr->srcVectorPtr = vector_alloc(1);
     mazePtr->dstVectorPtr = vector_alloc(1);
+    mazePtr->layout = GRID_LAYOUT_LINEAR;
+    mazePtr->commit = GRID_COMMIT_LOCK;
+    mazePtr->order = MAZE_ORDER_DISTANCE;
+    mazePtr->orderSeed = 0;
     assert(mazePtr->workQueuePtr &&
        mazePtr->wallVectorPtr &&
        mazePtr->srcVectorPtr &&
@@ -146,6 +153,114 @@ static void addToGrid (grid_t* gridPtr, vector_t* vectorPtr, char* type){
   grid_addPath(gridPtr, vectorPtr);
 }
 
+/* =============================================================================
+ * maze_parseOrder
+ * -- Returns MAZE_ORDER_INVALID if the name is unknown
+ * =============================================================================
+ */
+maze_order_t maze_parseOrder (const char* name){
+  if (strcmp(name, "distance") == 0) {
+    return MAZE_ORDER_DISTANCE;
+  }
+  if (strcmp(name, "shortest") == 0) {
+    return MAZE_ORDER_SHORTEST;
+  }
+  if (strcmp(name, "longest") == 0) {
+    return MAZE_ORDER_LONGEST;
+  }
+  if (strcmp(name, "area") == 0) {
+    return MAZE_ORDER_AREA;
+  }
+  if (strcmp(name, "hilbert") == 0) {
+    return MAZE_ORDER_HILBERT;
+  }
+  if (strcmp(name, "random") == 0) {
+    return MAZE_ORDER_RANDOM;
+  }
+  return MAZE_ORDER_INVALID;
+}
+
+
+/* =============================================================================
+ * getHilbertIndex
+ * -- Position of (x, y) along the Hilbert curve filling a side x side
+ *    square, side being a power of two
+ * =============================================================================
+ */
+static long getHilbertIndex (long side, long x, long y){
+  long d = 0;
+  long s;
+  for (s = side / 2; s > 0; s /= 2) {
+    long rx = ((x & s) ? 1 : 0);
+    long ry = ((y & s) ? 1 : 0);
+    d += s * s * ((3 * rx) ^ ry);
+    /* rotate the quadrant so the curve stays continuous */
+    if (ry == 0) {
+      if (rx == 1) {
+        x = side - 1 - x;
+        y = side - 1 - y;
+      }
+      long t = x;
+      x = y;
+      y = t;
+    }
+  }
+  return d;
+}
+
+
+/* =============================================================================
+ * getOrderKey
+ * -- Nets are routed by increasing key
+ * =============================================================================
+ */
+static long getOrderKey (maze_t* mazePtr, pair_t* coordinatePairPtr, long side, unsigned short* randomState){
+  coordinate_t* srcPtr = (coordinate_t*)coordinatePairPtr->firstPtr;
+  coordinate_t* dstPtr = (coordinate_t*)coordinatePairPtr->secondPtr;
+  long dx = labs(srcPtr->x - dstPtr->x);
+  long dy = labs(srcPtr->y - dstPtr->y);
+  long dz = labs(srcPtr->z - dstPtr->z);
+
+  switch (mazePtr->order) {
+    case MAZE_ORDER_SHORTEST:
+      return (dx + dy + dz);
+    case MAZE_ORDER_LONGEST:
+      return -(dx + dy + dz);
+    case MAZE_ORDER_AREA:
+      return ((dx + 1) * (dy + 1) * (dz + 1));
+    case MAZE_ORDER_HILBERT:
+      /* twice the centre, to stay on integers */
+      return getHilbertIndex(side, (srcPtr->x + dstPtr->x), (srcPtr->y + dstPtr->y));
+    case MAZE_ORDER_RANDOM:
+      return nrand48(randomState);
+    case MAZE_ORDER_DISTANCE:
+    default:
+      return 0; /* keep the order of the work list */
+  }
+}
+
+
+/* =============================================================================
+ * compareNets
+ * -- By key, then by position in the work list, so sorting is stable
+ * =============================================================================
+ */
+typedef struct maze_net {
+  long key;
+  long rank;
+  pair_t* coordinatePairPtr;
+} maze_net_t;
+
+static int compareNets (const void* aPtr, const void* bPtr){
+  const maze_net_t* aNetPtr = (const maze_net_t*)aPtr;
+  const maze_net_t* bNetPtr = (const maze_net_t*)bPtr;
+  if (aNetPtr->key != bNetPtr->key) {
+    return ((aNetPtr->key < bNetPtr->key) ? -1 : 1);
+  }
+  return ((aNetPtr->rank < bNetPtr->rank) ? -1 : ((aNetPtr->rank > bNetPtr->rank) ? 1 : 0));
+}
+
+
 /* =============================================================================
  * maze_read
  * -- Return number of path to route
@@ -259,7 +374,7 @@ long maze_read (maze_t* mazePtr, const char * const input_filename, FILE *out_st
         width, height, depth);
     exit(1);
   }
-  grid_t* gridPtr = grid_alloc(width, height, depth);
+  grid_t* gridPtr = grid_alloc(width, height, depth, mazePtr->layout, mazePtr->commit);
   assert(gridPtr);
   mazePtr->gridPtr = gridPtr;
   addToGrid(gridPtr, wallVectorPtr, "wall");
@@ -269,14 +384,35 @@ long maze_read (maze_t* mazePtr, const char * const input_filename, FILE *out_st
   fprintf(out_stream, "Paths to route = %li\n", list_getSize(workListPtr));
   
   /*
-  * Initialize work queue
+  * Initialize work queue, in the requested order
   */
-  queue_t* workQueuePtr = mazePtr->workQueuePtr;
-  list_iter_t it;
-  list_iter_reset(&it, workListPtr);
-  while (list_iter_hasNext(&it, workListPtr)) {
-    pair_t* coordinatePairPtr = (pair_t*)list_iter_next(&it, workListPtr);
-    queue_push(workQueuePtr, (void*)coordinatePairPtr);
+  long numNet = list_getSize(workListPtr);
+  /* an empty work list (a board with no nets) leaves the queue empty */
+  if (numNet > 0) {
+    maze_net_t* nets = (maze_net_t*)malloc(numNet * sizeof(maze_net_t));
+    assert(nets);
+    long side = 1;
+    while (side < 2 * MAX(width, height)) {
+      side *= 2;
+    }
+    unsigned short randomState[3] = {0x330E, (unsigned short)mazePtr->orderSeed, (unsigned short)(mazePtr->orderSeed >> 16)};
+    long i = 0;
+    list_iter_t it;
+    list_iter_reset(&it, workListPtr);
+    while (list_iter_hasNext(&it, workListPtr)) {
+      pair_t* coordinatePairPtr = (pair_t*)list_iter_next(&it, workListPtr);
+      nets[i].key = getOrderKey(mazePtr, coordinatePairPtr, side, randomState);
+      nets[i].rank = i;
+      nets[i].coordinatePairPtr = coordinatePairPtr;
+      i++;
+    }
+    qsort(nets, numNet, sizeof(maze_net_t), compareNets);
+
+    queue_t* workQueuePtr = mazePtr->workQueuePtr;
+    for (i = 0; i < numNet; i++) {
+      queue_push(workQueuePtr, (void*)nets[i].coordinatePairPtr);
+    }
+    free(nets);
   }
   list_free(workListPtr);
   
@@ -295,7 +431,7 @@ bool_t maze_checkPaths (maze_t* mazePtr, list_t* pathVectorListPtr, bool_t doPri
   long i;
 
   /* Mark walls */
-  grid_t* testGridPtr = grid_alloc(width, height, depth);
+  grid_t* testGridPtr = grid_alloc(width, height, depth, GRID_LAYOUT_LINEAR, GRID_COMMIT_NONE);
   grid_addPath(testGridPtr, mazePtr->wallVectorPtr);
 
   /* Mark sources */
@@ -325,55 +461,42 @@ bool_t maze_checkPaths (maze_t* mazePtr, list_t* pathVectorListPtr, bool_t doPri
     long i;
     for (i = 0; i < numPath; i++) {
       id++;
-      vector_t* pointVectorPtr = (vector_t*)vector_at(pathVectorPtr, i);
-      /* Check start */
-      long* prevGridPointPtr = (long*)vector_at(pointVectorPtr, 0);
-      long x;
-      long y;
-      long z;
-      grid_getPointIndices(gridPtr, prevGridPointPtr, &x, &y, &z);
-      if (grid_getPoint(testGridPtr, x, y, z) != 0) {
-        grid_free(testGridPtr);
-        return FALSE;
-      }
+      path_t* pathPtr = (path_t*)vector_at(pathVectorPtr, i);
+      long numPoint = path_getNumPoint(pathPtr);
+      path_iter_t pathIt;
+      path_iter_reset(&pathIt, pathPtr, gridPtr);
       coordinate_t prevCoordinate;
-      grid_getPointIndices(gridPtr,
-                prevGridPointPtr,
-                &prevCoordinate.x,
-                &prevCoordinate.y,
-                &prevCoordinate.z);
-      long numPoint = vector_getSize(pointVectorPtr);
       long j;
-      for (j = 1; j < (numPoint-1); j++) { /* no need to check endpoints */
-        long* currGridPointPtr = (long*)vector_at(pointVectorPtr, j);
+      for (j = 0; j < numPoint; j++) {
         coordinate_t currCoordinate;
-        grid_getPointIndices(gridPtr,
-                  currGridPointPtr,
-                  &currCoordinate.x,
-                  &currCoordinate.y,
-                  &currCoordinate.z);
-        if (!coordinate_areAdjacent(&currCoordinate, &prevCoordinate)) {
+        path_iter_next(&pathIt, pathPtr, &currCoordinate);
+        long x = currCoordinate.x;
+        long y = currCoordinate.y;
+        long z = currCoordinate.z;
+        if (!grid_isPointValid(testGridPtr, x, y, z)) {
+          grid_free(testGridPtr);
+          return FALSE;
+        }
+        /* path_alloc only encodes unit moves, but check it like any path */
+        if (j > 0 && !coordinate_areAdjacent(&currCoordinate, &prevCoordinate)) {
           grid_free(testGridPtr);
           return FALSE;
         }
         prevCoordinate = currCoordinate;
-        long x = currCoordinate.x;
-        long y = currCoordinate.y;
-        long z = currCoordinate.z;
-        if (grid_getPoint(testGridPtr, x, y, z) != GRID_POINT_EMPTY) {
+        if (j == 0 || j == (numPoint-1)) {
+          /* Check start and end */
+          if (grid_getPoint(testGridPtr, x, y, z) != 0) {
+            grid_free(testGridPtr);
+            return FALSE;
+          }
+        } else if (grid_getPoint(testGridPtr, x, y, z) != GRID_POINT_EMPTY) {
           grid_free(testGridPtr);
           return FALSE;
         } else {
           grid_setPoint(testGridPtr, x, y, z, id);
         }
       }
-      /* Check end */
-      long* lastGridPointPtr = (long*)vector_at(pointVectorPtr, j);
-      grid_getPointIndices(gridPtr, lastGridPointPtr, &x, &y, &z);
-      if (grid_getPoint(testGridPtr, x, y, z) != 0) {
-        grid_free(testGridPtr);
-        return FALSE;
-      }
+      assert(!path_iter_hasNext(&pathIt, pathPtr));
     } /* iteratate over pathVector */
   } /* iterate over pathVectorList */
 
@@ -63,12 +63,26 @@
 #include "lib/types.h"
 #include "lib/vector.h"
 
+typedef enum maze_order {
+  MAZE_ORDER_INVALID = -1,
+  MAZE_ORDER_DISTANCE = 0, /* longest euclidean distance first (coordinate_comparePair) */
+  MAZE_ORDER_SHORTEST,     /* shortest manhattan length first */
+  MAZE_ORDER_LONGEST,      /* longest manhattan length first */
+  MAZE_ORDER_AREA,         /* smallest bounding box first */
+  MAZE_ORDER_HILBERT,      /* bounding box centres along a Hilbert curve in x and y */
+  MAZE_ORDER_RANDOM,       /* shuffled, reproducibly for a given seed */
+} maze_order_t;
+
 typedef struct maze {
   grid_t* gridPtr;
   queue_t* workQueuePtr;  /* contains source/destination pairs to route */
   vector_t* wallVectorPtr; /* obstacles */
   vector_t* srcVectorPtr; /* sources */
   vector_t* dstVectorPtr; /* destinations */
+  grid_layout_t layout; /* of the grid maze_read allocates */
+  grid_commit_t commit; /* of its paths */
+  maze_order_t order;   /* of the nets in workQueuePtr */
+  long orderSeed;       /* MAZE_ORDER_RANDOM only */
 } maze_t;
 
 
@@ -86,6 +100,14 @@ maze_t* maze_alloc ();
 void maze_free (maze_t* mazePtr);
 
 
+/* =============================================================================
+ * maze_parseOrder
+ * -- Returns MAZE_ORDER_INVALID if the name is unknown
+ * =============================================================================
+ */
+maze_order_t maze_parseOrder (const char* name);
+
+
 /* =============================================================================
  * maze_read
  * -- Return number of path to route
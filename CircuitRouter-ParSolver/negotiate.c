@@ -0,0 +1,458 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * negotiate.c
+ *
+ * negotiated congestion routing (PathFinder): rip-up and reroute of the
+ * nets through overused points, with rising present and history costs
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "pthread_wrappers.h"
+
+#include "coordinate.h"
+#include "grid.h"
+#include "lib/heap.h"
+#include "lib/list.h"
+#include "maze.h"
+#include "negotiate.h"
+#include "lib/pair.h"
+#include "path.h"
+#include "lib/queue.h"
+#include "router.h"
+#include "lib/timer.h"
+#include "lib/types.h"
+#include "lib/utility.h"
+#include "lib/vector.h"
+
+
+enum config {
+  PRESENT_FACTOR_GROWTH = 150,   /* percent per round, from 1 in the second round */
+  PRESENT_FACTOR_MAX = (1 << 16),
+  HISTORY_FACTOR = 1,            /* added per round and per extra net on a point */
+};
+
+/* indexed by path_move_t */
+static const long MOVE_X[] = {1, -1, 0, 0, 0, 0};
+static const long MOVE_Y[] = {0, 0, 1, -1, 0, 0};
+static const long MOVE_Z[] = {0, 0, 0, 0, 1, -1};
+
+/* the heap holds linear point indices in its void* slots */
+#define INDEX_TO_DATA(index) ((void*)(uintptr_t)(index))
+#define DATA_TO_INDEX(data)  ((long)(uintptr_t)(data))
+
+typedef struct negotiate_net {
+  pair_t* coordinatePairPtr;
+  long* points;     /* grid indices of the current path, dst first */
+  long numPoint;    /* 0: unrouted */
+  long capacity;
+  bool_t isDead;    /* walled off: not even a shared path exists */
+} negotiate_net_t;
+
+typedef struct negotiate {
+  router_t* routerPtr;
+  grid_t* gridPtr;  /* walls and endpoints only: paths are kept in the nets */
+  negotiate_net_t* nets;
+  long numNet;
+  long* todo;       /* nets to (re)route in this round */
+  long numTodo;
+  long nextTodo;    /* next entry of todo to be claimed */
+  int32_t* usage;   /* per point: paths through it (endpoints excluded) */
+  long* history;    /* per point: overuse accumulated over past rounds */
+  long presentFactor;
+  double budget;    /* seconds per round, <= 0: unbounded */
+  TIMER_T roundStart;
+} negotiate_t;
+
+typedef struct negotiate_thread {
+  negotiate_t* negotiatePtr;
+  heap_t* heapPtr;
+  long* costs;
+  unsigned long* stamps;   /* costs[i] is only set for this net if stamps[i] == stamp */
+  unsigned long stamp;
+  unsigned char* arrivals; /* path_move_t into each labelled point */
+  router_stats_t stats;
+} negotiate_thread_t;
+
+
+/* =============================================================================
+ * updateUsage
+ * -- Adds delta to the use count of every inner point of the net's path
+ * =============================================================================
+ */
+static void updateUsage (negotiate_t* negotiatePtr, negotiate_net_t* netPtr, int32_t delta){
+  long i;
+  for (i = 1; i < (netPtr->numPoint - 1); i++) {
+    /* other threads may be adding or ripping up paths through the point */
+    __atomic_fetch_add(&negotiatePtr->usage[netPtr->points[i]], delta, __ATOMIC_RELAXED);
+  }
+}
+
+
+/* =============================================================================
+ * isOverused
+ * -- TRUE if the net's path shares a point with another path
+ * =============================================================================
+ */
+static bool_t isOverused (negotiate_t* negotiatePtr, negotiate_net_t* netPtr){
+  long i;
+  for (i = 1; i < (netPtr->numPoint - 1); i++) {
+    if (negotiatePtr->usage[netPtr->points[i]] > 1) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/* =============================================================================
+ * getCost
+ * -- Price of stepping onto a point: the move cost plus the point's history,
+ *    scaled up by the paths already using it; never below the move cost,
+ *    so the distance estimate stays admissible
+ * =============================================================================
+ */
+static inline long getCost (negotiate_t* negotiatePtr, long index, long moveCost){
+  long usage = __atomic_load_n(&negotiatePtr->usage[index], __ATOMIC_RELAXED);
+  return ((moveCost + negotiatePtr->history[index]) * (1 + negotiatePtr->presentFactor * usage));
+}
+
+
+/* =============================================================================
+ * estimateCost
+ * =============================================================================
+ */
+static inline long estimateCost (router_t* routerPtr, long x, long y, long z, coordinate_t* dstPtr){
+  return (routerPtr->xCost * labs(x - dstPtr->x) +
+          routerPtr->yCost * labs(y - dstPtr->y) +
+          routerPtr->zCost * labs(z - dstPtr->z));
+}
+
+
+/* =============================================================================
+ * traceNet
+ * -- Stores the path found by searchNet in the net, from dst back to src
+ * =============================================================================
+ */
+static void traceNet (negotiate_thread_t* threadPtr, negotiate_net_t* netPtr, long srcIndex, long dstIndex){
+  grid_t* gridPtr = threadPtr->negotiatePtr->gridPtr;
+  long index = dstIndex;
+  long numPoint = 0;
+
+  while (1) {
+    if (numPoint == netPtr->capacity) {
+      netPtr->capacity = MAX(16, (2 * netPtr->capacity));
+      netPtr->points = (long*)realloc(netPtr->points, (netPtr->capacity * sizeof(long)));
+      assert(netPtr->points);
+    }
+    netPtr->points[numPoint++] = index;
+    if (index == srcIndex) {
+      break;
+    }
+    long move = threadPtr->arrivals[index];
+    long x;
+    long y;
+    long z;
+    grid_getPointIndices(gridPtr, &gridPtr->points[index], &x, &y, &z);
+    index = grid_getPointIndex(gridPtr, (x - MOVE_X[move]), (y - MOVE_Y[move]), (z - MOVE_Z[move]));
+    assert(numPoint < gridPtr->numCell);
+  }
+
+  netPtr->numPoint = numPoint;
+}
+
+
+/* =============================================================================
+ * searchNet
+ * -- A* from src to dst over the negotiated costs; walls and the endpoints
+ *    of other nets are never entered, points used by other paths are
+ *    unless isStrict
+ * -- Returns FALSE if dst cannot be reached
+ * =============================================================================
+ */
+static bool_t searchNet (negotiate_thread_t* threadPtr, negotiate_net_t* netPtr, bool_t isStrict){
+  negotiate_t* negotiatePtr = threadPtr->negotiatePtr;
+  router_t* routerPtr = negotiatePtr->routerPtr;
+  grid_t* gridPtr = negotiatePtr->gridPtr;
+  heap_t* heapPtr = threadPtr->heapPtr;
+  long* costs = threadPtr->costs;
+  unsigned long* stamps = threadPtr->stamps;
+  unsigned long stamp = ++threadPtr->stamp;
+  router_stats_t* statsPtr = &threadPtr->stats;
+  long moveCosts[] = {routerPtr->xCost, routerPtr->xCost,
+                      routerPtr->yCost, routerPtr->yCost,
+                      routerPtr->zCost, routerPtr->zCost};
+
+  coordinate_t* srcPtr = (coordinate_t*)netPtr->coordinatePairPtr->firstPtr;
+  coordinate_t* dstPtr = (coordinate_t*)netPtr->coordinatePairPtr->secondPtr;
+  long srcIndex = grid_getPointIndex(gridPtr, srcPtr->x, srcPtr->y, srcPtr->z);
+  long dstIndex = grid_getPointIndex(gridPtr, dstPtr->x, dstPtr->y, dstPtr->z);
+
+  heap_clear(heapPtr);
+  costs[srcIndex] = 0;
+  stamps[srcIndex] = stamp;
+  heap_insert(heapPtr, estimateCost(routerPtr, srcPtr->x, srcPtr->y, srcPtr->z, dstPtr), INDEX_TO_DATA(srcIndex));
+
+  while (!heap_isEmpty(heapPtr)) {
+
+    long key;
+    long index = DATA_TO_INDEX(heap_remove(heapPtr, &key));
+    if (index == dstIndex) {
+      traceNet(threadPtr, netPtr, srcIndex, dstIndex);
+      return TRUE;
+    }
+
+    long x;
+    long y;
+    long z;
+    grid_getPointIndices(gridPtr, &gridPtr->points[index], &x, &y, &z);
+    long cost = costs[index];
+
+    /* The point was relaxed again after this entry was pushed: already expanded */
+    if (key != cost + estimateCost(routerPtr, x, y, z, dstPtr)) {
+      continue;
+    }
+    statsPtr->expansions++;
+
+    long move;
+    for (move = PATH_MOVE_POSX; move <= PATH_MOVE_NEGZ; move++) {
+      long nx = x + MOVE_X[move];
+      long ny = y + MOVE_Y[move];
+      long nz = z + MOVE_Z[move];
+      if (!grid_isPointValid(gridPtr, nx, ny, nz)) {
+        continue;
+      }
+      long neighborIndex = grid_getPointIndex(gridPtr, nx, ny, nz);
+      long neighborCost;
+      if (neighborIndex == dstIndex) {
+        neighborCost = cost + moveCosts[move];
+      } else if (grid_getCell(gridPtr, neighborIndex) == GRID_POINT_FULL ||
+                 (isStrict && negotiatePtr->usage[neighborIndex] > 0)) {
+        continue;
+      } else {
+        neighborCost = cost + getCost(negotiatePtr, neighborIndex, moveCosts[move]);
+      }
+      if (stamps[neighborIndex] != stamp || neighborCost < costs[neighborIndex]) {
+        stamps[neighborIndex] = stamp;
+        costs[neighborIndex] = neighborCost;
+        threadPtr->arrivals[neighborIndex] = (unsigned char)move;
+        heap_insert(heapPtr, neighborCost + estimateCost(routerPtr, nx, ny, nz, dstPtr), INDEX_TO_DATA(neighborIndex));
+        statsPtr->pushes++;
+      }
+    }
+
+  } /* iterate over work heap */
+
+  return FALSE;
+}
+
+
+/* =============================================================================
+ * routeNets
+ * -- Thread body of a round: claims nets from the round's list until it is
+ *    exhausted or the round's budget is spent
+ * =============================================================================
+ */
+static void* routeNets (void* argPtr){
+  negotiate_thread_t* threadPtr = (negotiate_thread_t*)argPtr;
+  negotiate_t* negotiatePtr = threadPtr->negotiatePtr;
+
+  while (1) {
+
+    if (negotiatePtr->budget > 0) {
+      TIMER_T now;
+      TIMER_READ(now);
+      if (TIMER_DIFF_SECONDS(negotiatePtr->roundStart, now) > negotiatePtr->budget) {
+        break;
+      }
+    }
+
+    long t = __atomic_fetch_add(&negotiatePtr->nextTodo, 1, __ATOMIC_RELAXED);
+    if (t >= negotiatePtr->numTodo) {
+      break;
+    }
+    negotiate_net_t* netPtr = &negotiatePtr->nets[negotiatePtr->todo[t]];
+
+    /* rip up */
+    if (netPtr->numPoint > 0) {
+      updateUsage(negotiatePtr, netPtr, -1);
+      netPtr->numPoint = 0;
+      threadPtr->stats.retries++;
+    }
+
+    /* and reroute */
+    if (searchNet(threadPtr, netPtr, FALSE)) {
+      updateUsage(negotiatePtr, netPtr, 1);
+    } else {
+      netPtr->isDead = TRUE;
+    }
+
+  }
+
+  return NULL;
+}
+
+
+/* =============================================================================
+ * negotiate_run
+ * -- Routes the nets of the maze's work queue with numThread threads in at
+ *    most routerPtr->negotiateIterations rounds, and inserts a vector of
+ *    their paths (path_t) in pathVectorListPtr
+ * -- A round stops claiming nets once routerPtr->negotiateBudget
+ *    milliseconds have passed, the others keeping their previous paths
+ * -- Nets still sharing points after the last round are dropped, so the
+ *    result is legal; so are nets walled off from their destination
+ * =============================================================================
+ */
+void negotiate_run (router_t* routerPtr, maze_t* mazePtr, long numThread, list_t* pathVectorListPtr, router_stats_t* statsPtr){
+  grid_t* gridPtr = mazePtr->gridPtr;
+  queue_t* workQueuePtr = mazePtr->workQueuePtr;
+  long numCell = gridPtr->numCell;
+  long i;
+
+  /* nets keep the work queue's order, which also decides who is dropped first */
+  vector_t* pairVectorPtr = vector_alloc(1);
+  assert(pairVectorPtr);
+  while (!queue_isEmpty(workQueuePtr)) {
+    bool_t status = vector_pushBack(pairVectorPtr, queue_pop(workQueuePtr));
+    assert(status);
+  }
+
+  negotiate_t negotiate;
+  negotiate.routerPtr = routerPtr;
+  negotiate.gridPtr = gridPtr;
+  negotiate.numNet = vector_getSize(pairVectorPtr);
+  negotiate.nets = (negotiate_net_t*)calloc((negotiate.numNet + 1), sizeof(negotiate_net_t));
+  negotiate.todo = (long*)malloc((negotiate.numNet + 1) * sizeof(long));
+  negotiate.usage = (int32_t*)calloc(numCell, sizeof(int32_t));
+  negotiate.history = (long*)calloc(numCell, sizeof(long));
+  assert(negotiate.nets && negotiate.todo && negotiate.usage && negotiate.history);
+  negotiate.presentFactor = 0; /* the first round routes every net as if alone */
+  negotiate.budget = routerPtr->negotiateBudget / 1000.0;
+
+  for (i = 0; i < negotiate.numNet; i++) {
+    negotiate.nets[i].coordinatePairPtr = (pair_t*)vector_at(pairVectorPtr, i);
+  }
+  vector_free(pairVectorPtr);
+
+  negotiate_thread_t* threads = (negotiate_thread_t*)calloc(numThread, sizeof(negotiate_thread_t));
+  pthread_t* workingThreads = (pthread_t*)malloc(numThread * sizeof(pthread_t));
+  assert(threads && workingThreads);
+  for (i = 0; i < numThread; i++) {
+    negotiate_thread_t* threadPtr = &threads[i];
+    threadPtr->negotiatePtr = &negotiate;
+    threadPtr->heapPtr = heap_alloc(1024);
+    threadPtr->costs = (long*)malloc(numCell * sizeof(long));
+    threadPtr->stamps = (unsigned long*)calloc(numCell, sizeof(unsigned long));
+    threadPtr->arrivals = (unsigned char*)malloc(numCell * sizeof(unsigned char));
+    assert(threadPtr->heapPtr && threadPtr->costs && threadPtr->stamps && threadPtr->arrivals);
+  }
+
+  long iteration;
+  for (iteration = 0; iteration < routerPtr->negotiateIterations; iteration++) {
+
+    /* unrouted nets, and nets sharing a point */
+    negotiate.numTodo = 0;
+    for (i = 0; i < negotiate.numNet; i++) {
+      negotiate_net_t* netPtr = &negotiate.nets[i];
+      if (!netPtr->isDead && (netPtr->numPoint == 0 || isOverused(&negotiate, netPtr))) {
+        negotiate.todo[negotiate.numTodo++] = i;
+      }
+    }
+    if (negotiate.numTodo == 0) {
+      break;
+    }
+
+    statsPtr->iterations++;
+    negotiate.nextTodo = 0;
+    TIMER_READ(negotiate.roundStart);
+    for (i = 0; i < numThread; i++) {
+      Pthread_create(abort_exec, "negotiate_run: failed to create thread", &workingThreads[i], NULL, routeNets, (void*)&threads[i]);
+    }
+    for (i = 0; i < numThread; i++) {
+      Pthread_join(abort_exec, "negotiate_run: failed to join thread", workingThreads[i], NULL);
+    }
+
+    /* sharing gets dearer, and more so where it keeps happening */
+    long presentFactor = negotiate.presentFactor * PRESENT_FACTOR_GROWTH / 100;
+    negotiate.presentFactor = MIN(MAX((negotiate.presentFactor + 1), presentFactor), PRESENT_FACTOR_MAX);
+    long c;
+    for (c = 0; c < numCell; c++) {
+      if (negotiate.usage[c] > 1) {
+        negotiate.history[c] += HISTORY_FACTOR * (negotiate.usage[c] - 1);
+      }
+    }
+  }
+
+  /* out of rounds: drop nets, in order, until no point is shared */
+  for (i = 0; i < negotiate.numNet; i++) {
+    negotiate_net_t* netPtr = &negotiate.nets[i];
+    if (netPtr->numPoint > 0 && isOverused(&negotiate, netPtr)) {
+      updateUsage(&negotiate, netPtr, -1);
+      netPtr->numPoint = 0;
+    }
+  }
+
+  /* then give each dropped net one more try, over the points left free */
+  for (i = 0; i < negotiate.numNet; i++) {
+    negotiate_net_t* netPtr = &negotiate.nets[i];
+    if (!netPtr->isDead && netPtr->numPoint == 0 && searchNet(&threads[0], netPtr, TRUE)) {
+      updateUsage(&negotiate, netPtr, 1);
+    }
+  }
+
+  /* keep the surviving paths */
+  vector_t* myPathVectorPtr = vector_alloc(1);
+  vector_t* pointVectorPtr = vector_alloc(1);
+  assert(myPathVectorPtr && pointVectorPtr);
+  for (i = 0; i < negotiate.numNet; i++) {
+    negotiate_net_t* netPtr = &negotiate.nets[i];
+    if (netPtr->numPoint > 0) {
+      vector_clear(pointVectorPtr);
+      long j;
+      for (j = 0; j < netPtr->numPoint; j++) {
+        bool_t status = vector_pushBack(pointVectorPtr, (void*)&gridPtr->points[netPtr->points[j]]);
+        assert(status);
+      }
+      /* a path path_alloc rejects is dropped like an unroutable net */
+      path_t* pathPtr = path_alloc(gridPtr, pointVectorPtr);
+      if (pathPtr) {
+        bool_t status = vector_pushBack(myPathVectorPtr, (void*)pathPtr);
+        assert(status);
+      }
+    }
+    free(netPtr->points);
+    pair_free(netPtr->coordinatePairPtr);
+  }
+  vector_free(pointVectorPtr);
+  list_insert(pathVectorListPtr, (void*)myPathVectorPtr);
+
+  for (i = 0; i < numThread; i++) {
+    negotiate_thread_t* threadPtr = &threads[i];
+    statsPtr->pushes += threadPtr->stats.pushes;
+    statsPtr->expansions += threadPtr->stats.expansions;
+    statsPtr->retries += threadPtr->stats.retries;
+    heap_free(threadPtr->heapPtr);
+    free(threadPtr->costs);
+    free(threadPtr->stamps);
+    free(threadPtr->arrivals);
+  }
+  free(threads);
+  free(workingThreads);
+  free(negotiate.nets);
+  free(negotiate.todo);
+  free(negotiate.usage);
+  free(negotiate.history);
+}
+
+
+/* =============================================================================
+ *
+ * End of negotiate.c
+ *
+ * =============================================================================
+ */
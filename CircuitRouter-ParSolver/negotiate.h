@@ -0,0 +1,51 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * negotiate.h
+ *
+ * negotiated congestion routing (PathFinder, McMurchie and Ebeling): nets
+ * are first routed as if alone, sharing points at a price, then every net
+ * through an overused point is ripped up and rerouted, with the price of
+ * sharing and a history of past overuse rising each round, until no point
+ * is shared
+ *
+ * the nets of a round are rerouted in parallel, each thread claiming the
+ * next one; the per-point use counts are updated atomically as paths are
+ * ripped up and added, so a net sees the others as they stand, and any
+ * overlap between nets routed at the same time is simply negotiated in the
+ * next round
+ * =============================================================================
+ */
+
+
+#ifndef NEGOTIATE_H
+#define NEGOTIATE_H 1
+
+
+#include "maze.h"
+#include "router.h"
+#include "lib/list.h"
+
+
+/* =============================================================================
+ * negotiate_run
+ * -- Routes the nets of the maze's work queue with numThread threads in at
+ *    most routerPtr->negotiateIterations rounds, and inserts a vector of
+ *    their paths (path_t) in pathVectorListPtr
+ * -- A round stops claiming nets once routerPtr->negotiateBudget
+ *    milliseconds have passed, the others keeping their previous paths
+ * -- Nets still sharing points after the last round are dropped, so the
+ *    result is legal; so are nets walled off from their destination
+ * =============================================================================
+ */
+void negotiate_run (router_t* routerPtr, maze_t* mazePtr, long numThread, list_t* pathVectorListPtr, router_stats_t* statsPtr);
+
+
+#endif /* NEGOTIATE_H */
+
+
+/* =============================================================================
+ *
+ * End of negotiate.h
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,218 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * partition.c
+ *
+ * spatially partitioned net assignment: nets whose bounding boxes overlap
+ * nets in flight are passed over, in favor of later ones
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "coordinate.h"
+#include "grid.h"
+#include "lib/pair.h"
+#include "partition.h"
+#include "lib/queue.h"
+#include "lib/types.h"
+#include "lib/utility.h"
+
+
+typedef struct partition_box {
+  long xFirst;
+  long xLast;
+  long yFirst;
+  long yLast;
+} partition_box_t;
+
+
+/* =============================================================================
+ * getBox
+ * -- Regions covered by the net's bounding box, widened by the margin
+ * =============================================================================
+ */
+static void getBox (partition_t* partitionPtr, pair_t* coordinatePairPtr, partition_box_t* boxPtr){
+  coordinate_t* srcPtr = (coordinate_t*)coordinatePairPtr->firstPtr;
+  coordinate_t* dstPtr = (coordinate_t*)coordinatePairPtr->secondPtr;
+  long regionSize = partitionPtr->regionSize;
+  long margin = partitionPtr->margin;
+
+  boxPtr->xFirst = MAX(0, (MIN(srcPtr->x, dstPtr->x) - margin)) / regionSize;
+  boxPtr->xLast = MIN((partitionPtr->numRegionX - 1), ((MAX(srcPtr->x, dstPtr->x) + margin) / regionSize));
+  boxPtr->yFirst = MAX(0, (MIN(srcPtr->y, dstPtr->y) - margin)) / regionSize;
+  boxPtr->yLast = MIN((partitionPtr->numRegionY - 1), ((MAX(srcPtr->y, dstPtr->y) + margin) / regionSize));
+}
+
+
+/* =============================================================================
+ * getOverlap
+ * -- Regions of the net's box covered by nets in flight (0: free)
+ * =============================================================================
+ */
+static long getOverlap (partition_t* partitionPtr, pair_t* coordinatePairPtr){
+  partition_box_t box;
+  getBox(partitionPtr, coordinatePairPtr, &box);
+
+  long numCovered = 0;
+  long y;
+  for (y = box.yFirst; y <= box.yLast; y++) {
+    long* counts = &partitionPtr->counts[y * partitionPtr->numRegionX];
+    long x;
+    for (x = box.xFirst; x <= box.xLast; x++) {
+      numCovered += (counts[x] > 0);
+    }
+  }
+
+  return numCovered;
+}
+
+
+/* =============================================================================
+ * mark
+ * -- Adds delta to the counts of the net's regions
+ * =============================================================================
+ */
+static void mark (partition_t* partitionPtr, pair_t* coordinatePairPtr, long delta){
+  partition_box_t box;
+  getBox(partitionPtr, coordinatePairPtr, &box);
+
+  long y;
+  for (y = box.yFirst; y <= box.yLast; y++) {
+    long* counts = &partitionPtr->counts[y * partitionPtr->numRegionX];
+    long x;
+    for (x = box.xFirst; x <= box.xLast; x++) {
+      counts[x] += delta;
+      assert(counts[x] >= 0);
+    }
+  }
+}
+
+
+/* =============================================================================
+ * partition_alloc
+ * -- Nets' bounding boxes are widened by margin points on every side
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+partition_t* partition_alloc (grid_t* gridPtr, long margin){
+  partition_t* partitionPtr = (partition_t*)malloc(sizeof(partition_t));
+  if (partitionPtr == NULL) {
+    return NULL;
+  }
+
+  /* big boards get bigger regions, keeping box scans short */
+  long side = MAX(gridPtr->width, gridPtr->height);
+  partitionPtr->regionSize = MAX(PARTITION_MIN_REGION, ((side + PARTITION_MAX_SPLIT - 1) / PARTITION_MAX_SPLIT));
+  partitionPtr->numRegionX = (gridPtr->width + partitionPtr->regionSize - 1) / partitionPtr->regionSize;
+  partitionPtr->numRegionY = (gridPtr->height + partitionPtr->regionSize - 1) / partitionPtr->regionSize;
+  partitionPtr->margin = margin;
+  partitionPtr->counts = (long*)calloc((partitionPtr->numRegionX * partitionPtr->numRegionY), sizeof(long));
+  if (partitionPtr->counts == NULL) {
+    free(partitionPtr);
+    return NULL;
+  }
+  partitionPtr->numPending = 0;
+  partitionPtr->numDeferral = 0;
+  partitionPtr->numOverlap = 0;
+
+  return partitionPtr;
+}
+
+
+/* =============================================================================
+ * partition_free
+ * =============================================================================
+ */
+void partition_free (partition_t* partitionPtr){
+  assert(partitionPtr->numPending == 0);
+  free(partitionPtr->counts);
+  free(partitionPtr);
+}
+
+
+/* =============================================================================
+ * partition_take
+ * -- Picks the next net to route, from the nets passed over or from
+ *    workQueuePtr, and marks it in flight
+ * -- Returns NULL if no net is left
+ * -- Not thread-safe: run under the work queue's lock
+ * =============================================================================
+ */
+pair_t* partition_take (partition_t* partitionPtr, queue_t* workQueuePtr){
+  pair_t** pending = partitionPtr->pending;
+  pair_t* coordinatePairPtr = NULL;
+  long taken = -1; /* index in pending of the net taken, if from there */
+  long best = -1;  /* of the nets passed over, the one overlapping least */
+  long bestOverlap = LONG_MAX;
+
+  /* nets passed over come first, oldest first */
+  long i;
+  for (i = 0; i < partitionPtr->numPending; i++) {
+    long overlap = getOverlap(partitionPtr, pending[i]);
+    if (overlap == 0) {
+      taken = i;
+      break;
+    }
+    if (overlap < bestOverlap) {
+      best = i;
+      bestOverlap = overlap;
+    }
+  }
+
+  if (taken < 0) {
+    while (partitionPtr->numPending < PARTITION_LOOKAHEAD && !queue_isEmpty(workQueuePtr)) {
+      pair_t* nextPairPtr = (pair_t*)queue_pop(workQueuePtr);
+      long overlap = getOverlap(partitionPtr, nextPairPtr);
+      if (overlap == 0) {
+        coordinatePairPtr = nextPairPtr;
+        break;
+      }
+      if (overlap < bestOverlap) {
+        best = partitionPtr->numPending;
+        bestOverlap = overlap;
+      }
+      pending[partitionPtr->numPending++] = nextPairPtr;
+      partitionPtr->numDeferral++;
+    }
+    if (coordinatePairPtr == NULL && best >= 0) {
+      /* everything within reach overlaps: better a conflict than an idle thread */
+      taken = best;
+      partitionPtr->numOverlap++;
+    }
+  }
+
+  if (taken >= 0) {
+    coordinatePairPtr = pending[taken];
+    for (i = taken; i < partitionPtr->numPending - 1; i++) {
+      pending[i] = pending[i + 1];
+    }
+    partitionPtr->numPending--;
+  }
+  if (coordinatePairPtr == NULL) {
+    return NULL;
+  }
+  mark(partitionPtr, coordinatePairPtr, 1);
+
+  return coordinatePairPtr;
+}
+
+
+/* =============================================================================
+ * partition_release
+ * -- The net taken is no longer in flight (routed, dropped or requeued)
+ * -- Not thread-safe: run under the work queue's lock
+ * =============================================================================
+ */
+void partition_release (partition_t* partitionPtr, pair_t* coordinatePairPtr){
+  mark(partitionPtr, coordinatePairPtr, -1);
+}
+
+
+/* =============================================================================
+ *
+ * End of partition.c
+ *
+ * =============================================================================
+ */
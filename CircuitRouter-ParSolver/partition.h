@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * partition.h
+ *
+ * spatially partitioned net assignment: the board is cut into square
+ * regions (all layers together), each counting the nets being routed whose
+ * bounding box, widened by a margin, covers it
+ *
+ * a thread asking for work gets the first net, in queue order, whose
+ * regions are all free; nets passed over wait in a small lookahead buffer
+ * and are the first considered next time. Only when every net within the
+ * lookahead overlaps one in flight is the one overlapping the fewest
+ * regions handed out anyway, so no thread is left waiting while nets remain
+ * =============================================================================
+ */
+
+
+#ifndef PARTITION_H
+#define PARTITION_H 1
+
+
+#include "grid.h"
+#include "lib/pair.h"
+#include "lib/queue.h"
+
+enum partition_config {
+  PARTITION_LOOKAHEAD = 32,  /* nets passed over held at most */
+  PARTITION_MIN_REGION = 8,  /* points per region side */
+  PARTITION_MAX_SPLIT = 32,  /* regions per board side */
+  PARTITION_DEFAULT_MARGIN = 1, /* when expansions are not windowed */
+};
+
+typedef struct partition {
+  long regionSize;
+  long numRegionX;
+  long numRegionY;
+  long margin;
+  long* counts;        /* per region: nets in flight covering it */
+  pair_t* pending[PARTITION_LOOKAHEAD]; /* nets passed over, oldest first */
+  long numPending;
+  long numDeferral;    /* nets passed over */
+  long numOverlap;     /* nets handed out over others in flight */
+} partition_t;
+
+
+/* =============================================================================
+ * partition_alloc
+ * -- Nets' bounding boxes are widened by margin points on every side
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+partition_t* partition_alloc (grid_t* gridPtr, long margin);
+
+
+/* =============================================================================
+ * partition_free
+ * =============================================================================
+ */
+void partition_free (partition_t* partitionPtr);
+
+
+/* =============================================================================
+ * partition_take
+ * -- Picks the next net to route, from the nets passed over or from
+ *    workQueuePtr, and marks it in flight
+ * -- Returns NULL if no net is left
+ * -- Not thread-safe: run under the work queue's lock
+ * =============================================================================
+ */
+pair_t* partition_take (partition_t* partitionPtr, queue_t* workQueuePtr);
+
+
+/* =============================================================================
+ * partition_release
+ * -- The net taken is no longer in flight (routed, dropped or requeued)
+ * -- Not thread-safe: run under the work queue's lock
+ * =============================================================================
+ */
+void partition_release (partition_t* partitionPtr, pair_t* coordinatePairPtr);
+
+
+#endif /* PARTITION_H */
+
+
+/* =============================================================================
+ *
+ * End of partition.h
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,183 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * path.c
+ *
+ * compact routed path: the grid index of its first point followed by runs
+ * of unit moves, one byte per run
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "coordinate.h"
+#include "grid.h"
+#include "path.h"
+#include "lib/types.h"
+#include "lib/vector.h"
+
+
+/* indexed by path_move_t */
+static const long MOVE_X[] = {1, -1, 0, 0, 0, 0};
+static const long MOVE_Y[] = {0, 0, 1, -1, 0, 0};
+static const long MOVE_Z[] = {0, 0, 0, 0, 1, -1};
+
+
+/* =============================================================================
+ * getMove
+ * -- Returns -1 if the points are not adjacent
+ * =============================================================================
+ */
+static long getMove (coordinate_t* fromPtr, coordinate_t* toPtr){
+  long move;
+  for (move = PATH_MOVE_POSX; move <= PATH_MOVE_NEGZ; move++) {
+    if (toPtr->x == fromPtr->x + MOVE_X[move] &&
+        toPtr->y == fromPtr->y + MOVE_Y[move] &&
+        toPtr->z == fromPtr->z + MOVE_Z[move])
+    {
+      return move;
+    }
+  }
+  return -1;
+}
+
+
+/* =============================================================================
+ * encodeRuns
+ * -- Returns the number of runs; they are only stored if runs is not NULL
+ * -- Returns -1 if two consecutive points are not adjacent
+ * =============================================================================
+ */
+static long encodeRuns (grid_t* gridPtr, vector_t* pointVectorPtr, unsigned char* runs){
+  long numPoint = vector_getSize(pointVectorPtr);
+  long numRun = 0;
+  long runMove = -1;
+  long runLength = 0;
+  coordinate_t prev;
+  grid_getPointIndices(gridPtr, (long*)vector_at(pointVectorPtr, 0), &prev.x, &prev.y, &prev.z);
+
+  long i;
+  for (i = 1; i < numPoint; i++) {
+    coordinate_t curr;
+    grid_getPointIndices(gridPtr, (long*)vector_at(pointVectorPtr, i), &curr.x, &curr.y, &curr.z);
+    long move = getMove(&prev, &curr);
+    if (move < 0) {
+      return -1;
+    }
+    if (move == runMove && runLength < PATH_RUN_MAX) {
+      runLength++;
+    } else {
+      numRun++;
+      runMove = move;
+      runLength = 1;
+    }
+    if (runs) {
+      runs[numRun - 1] = (unsigned char)((runMove << PATH_RUN_BITS) | (runLength - 1));
+    }
+    prev = curr;
+  }
+
+  return numRun;
+}
+
+
+/* =============================================================================
+ * path_alloc
+ * -- Encodes a vector of adjacent grid point pointers (as built by the
+ *    router's traceback)
+ * -- Returns NULL if two consecutive points are not adjacent, or on failure
+ * =============================================================================
+ */
+path_t* path_alloc (grid_t* gridPtr, vector_t* pointVectorPtr){
+  long numPoint = vector_getSize(pointVectorPtr);
+  assert(numPoint > 0);
+
+  /* one pass to size the runs, one to store them */
+  long numRun = encodeRuns(gridPtr, pointVectorPtr, NULL);
+  if (numRun < 0) {
+    return NULL;
+  }
+  path_t* pathPtr = (path_t*)malloc(sizeof(path_t) + numRun * sizeof(unsigned char));
+  if (pathPtr) {
+    pathPtr->startIndex = (long*)vector_at(pointVectorPtr, 0) - gridPtr->points;
+    pathPtr->numPoint = numPoint;
+    pathPtr->numRun = encodeRuns(gridPtr, pointVectorPtr, pathPtr->runs);
+  }
+
+  return pathPtr;
+}
+
+
+/* =============================================================================
+ * path_free
+ * =============================================================================
+ */
+void path_free (path_t* pathPtr){
+  free(pathPtr);
+}
+
+
+/* =============================================================================
+ * path_getNumPoint
+ * =============================================================================
+ */
+long path_getNumPoint (path_t* pathPtr){
+  return pathPtr->numPoint;
+}
+
+
+/* =============================================================================
+ * path_iter_reset
+ * -- The start index is decoded with gridPtr's layout
+ * =============================================================================
+ */
+void path_iter_reset (path_iter_t* itPtr, path_t* pathPtr, grid_t* gridPtr){
+  grid_getPointIndices(gridPtr, &gridPtr->points[pathPtr->startIndex], &itPtr->x, &itPtr->y, &itPtr->z);
+  itPtr->run = 0;
+  itPtr->step = 0;
+  itPtr->isStarted = FALSE;
+}
+
+
+/* =============================================================================
+ * path_iter_hasNext
+ * =============================================================================
+ */
+bool_t path_iter_hasNext (path_iter_t* itPtr, path_t* pathPtr){
+  return ((!itPtr->isStarted || itPtr->run < pathPtr->numRun) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * path_iter_next
+ * -- Stores the coordinates of the next point in coordinatePtr
+ * =============================================================================
+ */
+void path_iter_next (path_iter_t* itPtr, path_t* pathPtr, coordinate_t* coordinatePtr){
+  if (!itPtr->isStarted) {
+    itPtr->isStarted = TRUE;
+  } else {
+    unsigned char run = pathPtr->runs[itPtr->run];
+    long move = run >> PATH_RUN_BITS;
+    itPtr->x += MOVE_X[move];
+    itPtr->y += MOVE_Y[move];
+    itPtr->z += MOVE_Z[move];
+    itPtr->step++;
+    if (itPtr->step > (run & (PATH_RUN_MAX - 1))) {
+      itPtr->run++;
+      itPtr->step = 0;
+    }
+  }
+
+  coordinatePtr->x = itPtr->x;
+  coordinatePtr->y = itPtr->y;
+  coordinatePtr->z = itPtr->z;
+}
+
+
+/* =============================================================================
+ *
+ * End of path.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,108 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * path.h
+ *
+ * compact routed path: the grid index of its first point followed by runs
+ * of unit moves, one byte per run (the move in the high 3 bits, the run
+ * length minus one in the low 5)
+ *
+ * a straight stretch of up to PATH_RUN_MAX points costs one byte, where a
+ * vector of grid point pointers costs eight bytes per point
+ * =============================================================================
+ */
+
+
+#ifndef PATH_H
+#define PATH_H 1
+
+
+#include "coordinate.h"
+#include "grid.h"
+#include "lib/types.h"
+#include "lib/vector.h"
+
+typedef enum path_move {
+  PATH_MOVE_POSX = 0,
+  PATH_MOVE_NEGX,
+  PATH_MOVE_POSY,
+  PATH_MOVE_NEGY,
+  PATH_MOVE_POSZ,
+  PATH_MOVE_NEGZ,
+} path_move_t;
+
+#define PATH_RUN_BITS 5
+#define PATH_RUN_MAX (1L << PATH_RUN_BITS)
+
+typedef struct path {
+  long startIndex; /* grid index of the first point */
+  long numPoint;
+  long numRun;
+  unsigned char runs[];
+} path_t;
+
+typedef struct path_iter {
+  long x;
+  long y;
+  long z;
+  long run;  /* run the next point is reached by */
+  long step; /* points of that run already returned */
+  bool_t isStarted;
+} path_iter_t;
+
+
+/* =============================================================================
+ * path_alloc
+ * -- Encodes a vector of adjacent grid point pointers (as built by the
+ *    router's traceback)
+ * -- Returns NULL if two consecutive points are not adjacent, or on failure
+ * =============================================================================
+ */
+path_t* path_alloc (grid_t* gridPtr, vector_t* pointVectorPtr);
+
+
+/* =============================================================================
+ * path_free
+ * =============================================================================
+ */
+void path_free (path_t* pathPtr);
+
+
+/* =============================================================================
+ * path_getNumPoint
+ * =============================================================================
+ */
+long path_getNumPoint (path_t* pathPtr);
+
+
+/* =============================================================================
+ * path_iter_reset
+ * -- The start index is decoded with gridPtr's layout
+ * =============================================================================
+ */
+void path_iter_reset (path_iter_t* itPtr, path_t* pathPtr, grid_t* gridPtr);
+
+
+/* =============================================================================
+ * path_iter_hasNext
+ * =============================================================================
+ */
+bool_t path_iter_hasNext (path_iter_t* itPtr, path_t* pathPtr);
+
+
+/* =============================================================================
+ * path_iter_next
+ * -- Stores the coordinates of the next point in coordinatePtr
+ * =============================================================================
+ */
+void path_iter_next (path_iter_t* itPtr, path_t* pathPtr, coordinate_t* coordinatePtr);
+
+
+#endif /* PATH_H */
+
+
+/* =============================================================================
+ *
+ * End of path.h
+ *
+ * =============================================================================
+ */
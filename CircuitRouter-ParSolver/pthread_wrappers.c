@@ -171,3 +171,45 @@ int Pthread_mutexattr_destroy (wrapper_action action, const char * const error_s
   return ret;
 }
 
+
+
+int Pthread_cond_init (wrapper_action action, const char * const error_string, pthread_cond_t *__restrict __cond,
+			      const pthread_condattr_t *__restrict __cond_attr)
+{
+  int ret = pthread_cond_init(__cond, __cond_attr);
+  if (ret)
+    handle_error(action, ret, error_string);
+
+  return ret;
+}
+
+
+int Pthread_cond_destroy (wrapper_action action, const char * const error_string, pthread_cond_t *__cond)
+{
+  int ret = pthread_cond_destroy(__cond);
+  if (ret)
+    handle_error(action, ret, error_string);
+
+  return ret;
+}
+
+
+int Pthread_cond_wait (wrapper_action action, const char * const error_string, pthread_cond_t *__restrict __cond,
+			      pthread_mutex_t *__restrict __mutex)
+{
+  int ret = pthread_cond_wait(__cond, __mutex);
+  if (ret)
+    handle_error(action, ret, error_string);
+
+  return ret;
+}
+
+
+int Pthread_cond_broadcast (wrapper_action action, const char * const error_string, pthread_cond_t *__cond)
+{
+  int ret = pthread_cond_broadcast(__cond);
+  if (ret)
+    handle_error(action, ret, error_string);
+
+  return ret;
+}
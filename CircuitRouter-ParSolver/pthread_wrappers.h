@@ -62,4 +62,14 @@ extern int Pthread_mutexattr_init (wrapper_action action, const char * const err
  
 extern int Pthread_mutexattr_destroy (wrapper_action action, const char * const error_string, pthread_mutexattr_t *__attr);
 
+extern int Pthread_cond_init (wrapper_action action, const char * const error_string, pthread_cond_t *__restrict __cond,
+			      const pthread_condattr_t *__restrict __cond_attr);
+
+extern int Pthread_cond_destroy (wrapper_action action, const char * const error_string, pthread_cond_t *__cond);
+
+extern int Pthread_cond_wait (wrapper_action action, const char * const error_string, pthread_cond_t *__restrict __cond,
+			      pthread_mutex_t *__restrict __mutex);
+
+extern int Pthread_cond_broadcast (wrapper_action action, const char * const error_string, pthread_cond_t *__cond);
+
 #endif	/* pthread_wrappers.h */
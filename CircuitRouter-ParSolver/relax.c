@@ -0,0 +1,118 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * relax.c
+ *
+ * row relaxation kernels for the sweeping expansion engine
+ * =============================================================================
+ */
+
+#include <stdint.h>
+#include "lib/types.h"
+#include "relax.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define RELAX_X86 1
+#  include <immintrin.h>
+#endif
+
+
+/* =============================================================================
+ * relaxRow_scalar
+ * =============================================================================
+ */
+static bool_t relaxRow_scalar (int32_t* dist, const int32_t* from, const int32_t* wall, long n, int32_t cost){
+  bool_t isChanged = FALSE;
+  long i;
+  for (i = 0; i < n; i++) {
+    int32_t candidate = from[i] + cost;
+    if (candidate < wall[i]) {
+      candidate = wall[i];
+    }
+    if (candidate < dist[i]) {
+      dist[i] = candidate;
+      isChanged = TRUE;
+    }
+  }
+  return isChanged;
+}
+
+
+#ifdef RELAX_X86
+
+/* =============================================================================
+ * relaxRow_sse41
+ * =============================================================================
+ */
+__attribute__((target("sse4.1")))
+static bool_t relaxRow_sse41 (int32_t* dist, const int32_t* from, const int32_t* wall, long n, int32_t cost){
+  __m128i costs = _mm_set1_epi32(cost);
+  __m128i changed = _mm_setzero_si128();
+  long i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m128i d = _mm_loadu_si128((const __m128i*)&dist[i]);
+    __m128i candidate = _mm_max_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i*)&from[i]), costs),
+                                      _mm_loadu_si128((const __m128i*)&wall[i]));
+    changed = _mm_or_si128(changed, _mm_cmplt_epi32(candidate, d));
+    _mm_storeu_si128((__m128i*)&dist[i], _mm_min_epi32(d, candidate));
+  }
+  bool_t isChanged = (_mm_movemask_epi8(changed) != 0);
+  if (i < n && relaxRow_scalar(&dist[i], &from[i], &wall[i], (n - i), cost)) {
+    isChanged = TRUE;
+  }
+  return isChanged;
+}
+
+
+/* =============================================================================
+ * relaxRow_avx2
+ * =============================================================================
+ */
+__attribute__((target("avx2")))
+static bool_t relaxRow_avx2 (int32_t* dist, const int32_t* from, const int32_t* wall, long n, int32_t cost){
+  __m256i costs = _mm256_set1_epi32(cost);
+  __m256i changed = _mm256_setzero_si256();
+  long i;
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_loadu_si256((const __m256i*)&dist[i]);
+    __m256i candidate = _mm256_max_epi32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i*)&from[i]), costs),
+                                         _mm256_loadu_si256((const __m256i*)&wall[i]));
+    changed = _mm256_or_si256(changed, _mm256_cmpgt_epi32(d, candidate));
+    _mm256_storeu_si256((__m256i*)&dist[i], _mm256_min_epi32(d, candidate));
+  }
+  bool_t isChanged = (_mm256_movemask_epi8(changed) != 0);
+  if (i < n && relaxRow_scalar(&dist[i], &from[i], &wall[i], (n - i), cost)) {
+    isChanged = TRUE;
+  }
+  return isChanged;
+}
+
+#endif /* RELAX_X86 */
+
+
+/* =============================================================================
+ * relax_selectRow
+ * -- Returns the fastest row kernel for this CPU
+ * =============================================================================
+ */
+relax_row_t relax_selectRow (void){
+  relax_row_t kernel = &relaxRow_scalar;
+
+#ifdef RELAX_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    kernel = &relaxRow_avx2;
+  } else if (__builtin_cpu_supports("sse4.1")) {
+    kernel = &relaxRow_sse41;
+  }
+#endif
+
+  return kernel;
+}
+
+
+/* =============================================================================
+ *
+ * End of relax.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,46 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * relax.h
+ *
+ * row relaxation kernels for the sweeping expansion engine
+ *
+ * a kernel relaxes a whole x-row of a cost field against the row next to it
+ * in y or z:  dist[i] = min(dist[i], max(from[i] + cost, wall[i])),
+ * where wall[i] is 0 for free cells and RELAX_INFINITY for occupied ones
+ *
+ * the widest variant the CPU supports (AVX2, SSE4.1 or plain C) is picked
+ * at runtime by relax_selectRow
+ * =============================================================================
+ */
+
+#ifndef RELAX_H
+#define RELAX_H 1
+
+#include <stdint.h>
+#include "lib/types.h"
+
+/* unreached; large enough to stay unreachable, small enough not to overflow
+ * when a move cost is added to it */
+#define RELAX_INFINITY ((int32_t)(INT32_MAX / 2))
+
+/* returns TRUE if any element of dist was lowered */
+typedef bool_t (*relax_row_t) (int32_t* dist, const int32_t* from, const int32_t* wall, long n, int32_t cost);
+
+
+/* =============================================================================
+ * relax_selectRow
+ * -- Returns the fastest row kernel for this CPU
+ * =============================================================================
+ */
+relax_row_t relax_selectRow (void);
+
+
+#endif /* RELAX_H */
+
+
+/* =============================================================================
+ *
+ * End of relax.h
+ *
+ * =============================================================================
+ */
@@ -52,14 +52,26 @@
 
 
 #include <assert.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include "pthread_wrappers.h"
+#include "batch.h"
 
 #include "coordinate.h"
 #include "grid.h"
+#include "lib/bucketqueue.h"
+#include "lib/heap.h"
+#include "lib/indexqueue.h"
 #include "lib/queue.h"
+#include "lib/timer.h"
+#include "path.h"
+#include "relax.h"
 #include "router.h"
+#include "lib/utility.h"
 #include "lib/vector.h"
 
 
@@ -88,124 +100,1802 @@ point_t MOVE_NEGX = {-1, 0, 0, 0, MOMENTUM_NEGX};
 point_t MOVE_NEGY = { 0, -1, 0, 0, MOMENTUM_NEGY};
 point_t MOVE_NEGZ = { 0, 0, -1, 0, MOMENTUM_NEGZ};
 
+/* indexed by momentum_t */
+point_t* MOVES[] = {NULL, &MOVE_POSX, &MOVE_POSY, &MOVE_POSZ, &MOVE_NEGX, &MOVE_NEGY, &MOVE_NEGZ};
+
+/*
+ * The bidirectional engine keeps both waves in the same grid: labels from
+ * the src wave are the usual costs (>= 0), labels from the dst wave are
+ * stored as DST_WAVE_BASE - cost, below GRID_POINT_FULL and GRID_POINT_EMPTY
+ */
+typedef enum wave {
+  WAVE_SRC = 0,
+  WAVE_DST = 1
+} wave_t;
+
+#define DST_WAVE_BASE (-3L)
+
+/* the generic queues hold linear point indices in their void* slots */
+#define INDEX_TO_DATA(index) ((void*)(uintptr_t)(index))
+#define DATA_TO_INDEX(data)  ((long)(uintptr_t)(data))
+
+enum config {
+  WINDOW_GROWTH_FACTOR = 2,
+  REPAIR_MAX_ROUNDS = 4,     /* repairs of a path before its net is requeued */
+};
+
+/* bitset: the words of cells each layer of the wave first reached, in
+ * plane word order, so the traceback needs no labels on the private grid */
+typedef struct bitset_log {
+  long* keys;          /* plane word (row * stride + word) of each entry */
+  uint64_t* bits;
+  long numEntry;
+  long capacity;
+  long* layerStarts;   /* first entry of each layer */
+  long numLayer;
+  long layerCapacity;
+} bitset_log_t;
+
+typedef struct router_workspace {
+  indexqueue_t* indexqueuePtr; /* lee */
+  queue_t* queuePtr;    /* bidir (src wave) */
+  queue_t* dstQueuePtr; /* bidir (dst wave) */
+  heap_t* heapPtr;      /* astar */
+  bucketqueue_t* bucketqueuePtr; /* dial */
+  uint64_t* bitsPtr;    /* bitset: visited, frontier and next layer bit planes */
+  bitset_log_t bitsetLog; /* bitset: cells reached, layer by layer */
+  int32_t* sweepDistPtr; /* sweep: cost field */
+  int32_t* sweepWallPtr; /* sweep: 0 or RELAX_INFINITY per point */
+  relax_row_t relaxRow;  /* sweep: row kernel picked for this CPU */
+  unsigned char* arrivals; /* arrival traceback: momentum_t of the move into each cell */
+  vector_t* pointVectorPtr; /* grid points of the last path traced */
+  vector_t* detourVectorPtr; /* repair: detour around the points taken */
+  vector_t* spliceVectorPtr; /* repair: path with the detour in, swapped with pointVectorPtr */
+  grid_claim_t* claimPtr;   /* what the commit of the last path holds */
+  struct router_delta* deltaPtr; /* delta, or long nets: allocated when first needed */
+  router_crew_t* crewPtr;   /* threads that can join a delta team, NULL if none */
+  bool_t isTail;            /* fewer nets are queued than threads: expand as a delta team, if idle threads join */
+  bool_t isSharedRead;      /* the last expansion read the shared grid, not the private one */
+  router_stats_t stats;
+} router_workspace_t;
+
 /* =============================================================================
  * router_alloc
  * =============================================================================
  */
-router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost){
+router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost, router_expansion_t expansion){
   router_t* routerPtr;
 
-  routerPtr = (router_t*)malloc(sizeof(router_t));
-  if (routerPtr) {
-    routerPtr->xCost = xCost;
-    routerPtr->yCost = yCost;
-    routerPtr->zCost = zCost;
-    routerPtr->bendCost = bendCost;
+  routerPtr = (router_t*)malloc(sizeof(router_t));
+  if (routerPtr) {
+    routerPtr->xCost = xCost;
+    routerPtr->yCost = yCost;
+    routerPtr->zCost = zCost;
+    routerPtr->bendCost = bendCost;
+    routerPtr->expansion = expansion;
+    routerPtr->windowMargin = -1;
+    routerPtr->scratch = ROUTER_SCRATCH_COPY;
+    routerPtr->cellBits = 64;
+    routerPtr->traceback = ROUTER_TRACEBACK_SCAN;
+    routerPtr->negotiateIterations = 0;
+    routerPtr->negotiateBudget = 0;
+    routerPtr->deltaThreshold = -1;
+    routerPtr->schedule = ROUTER_SCHEDULE_NETS;
+    routerPtr->repairMargin = -1;
+  }
+
+  return routerPtr;
+}
+
+
+/* =============================================================================
+ * router_free
+ * =============================================================================
+ */
+void router_free (router_t* routerPtr){
+  free(routerPtr);
+}
+
+
+/* =============================================================================
+ * router_parseExpansion
+ * -- Returns ROUTER_EXPANSION_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_expansion_t router_parseExpansion (const char* name){
+  if (strcmp(name, "lee") == 0) {
+    return ROUTER_EXPANSION_LEE;
+  }
+  if (strcmp(name, "astar") == 0) {
+    return ROUTER_EXPANSION_ASTAR;
+  }
+  if (strcmp(name, "bidir") == 0) {
+    return ROUTER_EXPANSION_BIDIR;
+  }
+  if (strcmp(name, "dial") == 0) {
+    return ROUTER_EXPANSION_DIAL;
+  }
+  if (strcmp(name, "bitset") == 0) {
+    return ROUTER_EXPANSION_BITSET;
+  }
+  if (strcmp(name, "sweep") == 0) {
+    return ROUTER_EXPANSION_SWEEP;
+  }
+  if (strcmp(name, "delta") == 0) {
+    return ROUTER_EXPANSION_DELTA;
+  }
+  return ROUTER_EXPANSION_INVALID;
+}
+
+
+/* =============================================================================
+ * router_parseSchedule
+ * -- Returns ROUTER_SCHEDULE_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_schedule_t router_parseSchedule (const char* name){
+  if (strcmp(name, "nets") == 0) {
+    return ROUTER_SCHEDULE_NETS;
+  }
+  if (strcmp(name, "hybrid") == 0) {
+    return ROUTER_SCHEDULE_HYBRID;
+  }
+  if (strcmp(name, "spatial") == 0) {
+    return ROUTER_SCHEDULE_SPATIAL;
+  }
+  if (strcmp(name, "steal") == 0) {
+    return ROUTER_SCHEDULE_STEAL;
+  }
+  if (strcmp(name, "batch") == 0) {
+    return ROUTER_SCHEDULE_BATCH;
+  }
+  return ROUTER_SCHEDULE_INVALID;
+}
+
+
+/* =============================================================================
+ * router_parseScratch
+ * -- Returns ROUTER_SCRATCH_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_scratch_t router_parseScratch (const char* name){
+  if (strcmp(name, "copy") == 0) {
+    return ROUTER_SCRATCH_COPY;
+  }
+  if (strcmp(name, "epoch") == 0) {
+    return ROUTER_SCRATCH_EPOCH;
+  }
+  return ROUTER_SCRATCH_INVALID;
+}
+
+
+/* =============================================================================
+ * router_parseTraceback
+ * -- Returns ROUTER_TRACEBACK_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_traceback_t router_parseTraceback (const char* name){
+  if (strcmp(name, "scan") == 0) {
+    return ROUTER_TRACEBACK_SCAN;
+  }
+  if (strcmp(name, "arrival") == 0) {
+    return ROUTER_TRACEBACK_ARRIVAL;
+  }
+  return ROUTER_TRACEBACK_INVALID;
+}
+
+
+/* =============================================================================
+ * index_layout_t
+ * -- Turns the grid indices queued by the engines back into (x, y, z)
+ *    without dividing: n / d is computed as ((M + 1) * n) >> 64, with
+ *    M = floor((2^64 - 1) / d), which is exact for 32-bit n and d (Lemire,
+ *    Kaser and Kurz, "Faster remainder by direct computation")
+ * -- Also holds the index steps to the neighbors of a point: a move in x
+ *    or y that leaves a brick of the tiled layout takes the tile stride
+ *    instead; tileMask is LONG_MAX for the linear layout, where no
+ *    coordinate of a valid point can match it
+ * =============================================================================
+ */
+typedef struct index_layout {
+  bool_t isTiled;
+  uint64_t width;  /* points per row, or bricks per row of bricks if tiled */
+  uint64_t area;   /* points per layer, or layers per brick if tiled */
+  uint64_t widthRecip;
+  uint64_t areaRecip;
+  long tileMask;
+  long xStride;
+  long yStride;
+  long zStride;
+  long xTileStride;
+  long yTileStride;
+} index_layout_t;
+
+static void index_layout_init (index_layout_t* layoutPtr, grid_t* gridPtr){
+  if (gridPtr->layout == GRID_LAYOUT_TILED) {
+    long brickSize = gridPtr->depth * GRID_TILE_SIZE * GRID_TILE_SIZE;
+    layoutPtr->isTiled = TRUE;
+    layoutPtr->width = gridPtr->tilesX;
+    layoutPtr->area = gridPtr->depth;
+    layoutPtr->tileMask = GRID_TILE_MASK;
+    layoutPtr->xStride = 1;
+    layoutPtr->yStride = GRID_TILE_SIZE;
+    layoutPtr->zStride = GRID_TILE_SIZE * GRID_TILE_SIZE;
+    layoutPtr->xTileStride = brickSize - GRID_TILE_MASK;
+    layoutPtr->yTileStride = gridPtr->tilesX * brickSize - GRID_TILE_MASK * GRID_TILE_SIZE;
+  } else {
+    layoutPtr->isTiled = FALSE;
+    layoutPtr->width = gridPtr->width;
+    layoutPtr->area = gridPtr->width * gridPtr->height;
+    layoutPtr->tileMask = LONG_MAX;
+    layoutPtr->xStride = 1;
+    layoutPtr->yStride = gridPtr->width;
+    layoutPtr->zStride = gridPtr->width * gridPtr->height;
+    layoutPtr->xTileStride = layoutPtr->xStride;
+    layoutPtr->yTileStride = layoutPtr->yStride;
+  }
+  layoutPtr->widthRecip = UINT64_MAX / layoutPtr->width;
+  layoutPtr->areaRecip = UINT64_MAX / layoutPtr->area;
+}
+
+static inline uint64_t index_layout_divide (uint64_t n, uint64_t d, uint64_t recip){
+#ifdef __SIZEOF_INT128__
+  return (uint64_t)(((unsigned __int128)recip * n + n) >> 64);
+#else
+  return n / d;
+#endif
+}
+
+static inline void index_layout_getPoint (index_layout_t* layoutPtr, uint32_t index, long* xPtr, long* yPtr, long* zPtr){
+  if (layoutPtr->isTiled) {
+    uint64_t layer = index >> (2 * GRID_TILE_BITS);
+    uint64_t tile = index_layout_divide(layer, layoutPtr->area, layoutPtr->areaRecip);
+    uint64_t ty = index_layout_divide(tile, layoutPtr->width, layoutPtr->widthRecip);
+    (*zPtr) = (long)(layer - tile * layoutPtr->area);
+    (*yPtr) = (long)((ty << GRID_TILE_BITS) | ((index >> GRID_TILE_BITS) & GRID_TILE_MASK));
+    (*xPtr) = (long)(((tile - ty * layoutPtr->width) << GRID_TILE_BITS) | (index & GRID_TILE_MASK));
+    return;
+  }
+
+  uint64_t z = index_layout_divide(index, layoutPtr->area, layoutPtr->areaRecip);
+  uint64_t index2d = index - z * layoutPtr->area;
+  uint64_t y = index_layout_divide(index2d, layoutPtr->width, layoutPtr->widthRecip);
+  (*zPtr) = (long)z;
+  (*yPtr) = (long)y;
+  (*xPtr) = (long)(index2d - y * layoutPtr->width);
+}
+
+static inline long index_layout_getIndex (index_layout_t* layoutPtr, long x, long y, long z){
+  if (layoutPtr->isTiled) {
+    long tile = (y >> GRID_TILE_BITS) * (long)layoutPtr->width + (x >> GRID_TILE_BITS);
+    return ((((tile * (long)layoutPtr->area + z) << GRID_TILE_BITS | (y & GRID_TILE_MASK))
+             << GRID_TILE_BITS) | (x & GRID_TILE_MASK));
+  }
+  return (z * (long)layoutPtr->area + y * (long)layoutPtr->width + x);
+}
+
+
+/* =============================================================================
+ * recordArrival
+ * -- Notes the move that reached a cell (arrivals is NULL unless the arrival
+ *    traceback is used): always when the cell's cost improved, and on a tie
+ *    only when the move carries straight on from the cell it leaves, so the
+ *    traced path bends no more than the scanning traceback's would
+ * =============================================================================
+ */
+static inline void recordArrival (unsigned char* arrivals, long index, momentum_t move, momentum_t fromArrival, bool_t isImproved){
+  if (arrivals && (isImproved || move == fromArrival)) {
+    arrivals[index] = (unsigned char)move;
+  }
+}
+
+
+/* =============================================================================
+ * expandToNeighbor
+ * -- The caller has already checked that the neighbor is inside the window
+ * =============================================================================
+ */
+static inline void expandToNeighbor (grid_t* myGridPtr, long index, long value, momentum_t move, momentum_t fromArrival, unsigned char* arrivals, indexqueue_t* indexqueuePtr, router_stats_t* statsPtr){
+  long neighborValue = grid_getCell(myGridPtr, index);
+  if (neighborValue == GRID_POINT_EMPTY) {
+    grid_setCell(myGridPtr, index, value);
+    recordArrival(arrivals, index, move, fromArrival, TRUE);
+    indexqueue_push(indexqueuePtr, (uint32_t)index);
+    statsPtr->pushes++;
+  } else if (neighborValue != GRID_POINT_FULL) {
+    /* We have expanded here before... is this new path better? */
+    if (value < neighborValue) {
+      grid_setCell(myGridPtr, index, value);
+      recordArrival(arrivals, index, move, fromArrival, TRUE);
+      /* still queued: it will be expanded once, with the new value */
+      if (indexqueue_push(indexqueuePtr, (uint32_t)index)) {
+        statsPtr->pushes++;
+        statsPtr->reexpansions++; /* FIFO: every queued entry gets expanded */
+      }
+    } else if (value == neighborValue) {
+      recordArrival(arrivals, index, move, fromArrival, FALSE);
+    }
+  }
+}
+
+
+/* =============================================================================
+ * doExpansion
+ * -- Cells are queued by grid index and neighbors are reached by adding
+ *    the x, y and z strides of the layout, so the inner loop never builds
+ *    a pointer or divides
+ * =============================================================================
+ */
+static bool_t doExpansion (router_t* routerPtr, grid_t* myGridPtr, indexqueue_t* indexqueuePtr, unsigned char* arrivals, coordinate_t* srcPtr, coordinate_t* dstPtr, router_stats_t* statsPtr){
+  long xCost = routerPtr->xCost;
+  long yCost = routerPtr->yCost;
+  long zCost = routerPtr->zCost;
+
+  index_layout_t layout;
+  index_layout_init(&layout, myGridPtr);
+  long tileMask = layout.tileMask;
+  long zStride = layout.zStride;
+
+  long xMin = myGridPtr->xMin;
+  long xMax = myGridPtr->xMax;
+  long yMin = myGridPtr->yMin;
+  long yMax = myGridPtr->yMax;
+  long zMin = myGridPtr->zMin;
+  long zMax = myGridPtr->zMax;
+
+  /*
+   * Potential Optimization: Make 'src' the one closest to edge.
+   * This will likely decrease the area of the emitted wave.
+   */
+
+  indexqueue_clear(indexqueuePtr);
+  long srcIndex = index_layout_getIndex(&layout, srcPtr->x, srcPtr->y, srcPtr->z);
+  long dstIndex = index_layout_getIndex(&layout, dstPtr->x, dstPtr->y, dstPtr->z);
+  indexqueue_push(indexqueuePtr, (uint32_t)srcIndex);
+  grid_setCell(myGridPtr, srcIndex, 0);
+  grid_setCell(myGridPtr, dstIndex, GRID_POINT_EMPTY);
+  if (arrivals) {
+    arrivals[srcIndex] = MOMENTUM_ZERO;
+  }
+  bool_t isPathFound = FALSE;
+
+  while (!indexqueue_isEmpty(indexqueuePtr)) {
+
+    long index = (long)indexqueue_pop(indexqueuePtr);
+    if (index == dstIndex) {
+      isPathFound = TRUE;
+      break;
+    }
+
+    long x;
+    long y;
+    long z;
+    index_layout_getPoint(&layout, (uint32_t)index, &x, &y, &z);
+    long value = grid_getCell(myGridPtr, index);
+    momentum_t from = (arrivals ? (momentum_t)arrivals[index] : MOMENTUM_ZERO);
+    statsPtr->expansions++;
+
+    long xNext = (((x & tileMask) != tileMask) ? layout.xStride : layout.xTileStride);
+    long xPrev = ((x & tileMask) ? layout.xStride : layout.xTileStride);
+    long yNext = (((y & tileMask) != tileMask) ? layout.yStride : layout.yTileStride);
+    long yPrev = ((y & tileMask) ? layout.yStride : layout.yTileStride);
+
+    /*
+     * Check 6 neighbors
+     *
+     * Potential Optimization: Only need to check 5 of these
+     */
+    if (x < xMax) expandToNeighbor(myGridPtr, (index + xNext), (value + xCost), MOMENTUM_POSX, from, arrivals, indexqueuePtr, statsPtr);
+    if (x > xMin) expandToNeighbor(myGridPtr, (index - xPrev), (value + xCost), MOMENTUM_NEGX, from, arrivals, indexqueuePtr, statsPtr);
+    if (y < yMax) expandToNeighbor(myGridPtr, (index + yNext), (value + yCost), MOMENTUM_POSY, from, arrivals, indexqueuePtr, statsPtr);
+    if (y > yMin) expandToNeighbor(myGridPtr, (index - yPrev), (value + yCost), MOMENTUM_NEGY, from, arrivals, indexqueuePtr, statsPtr);
+    if (z < zMax) expandToNeighbor(myGridPtr, (index + zStride), (value + zCost), MOMENTUM_POSZ, from, arrivals, indexqueuePtr, statsPtr);
+    if (z > zMin) expandToNeighbor(myGridPtr, (index - zStride), (value + zCost), MOMENTUM_NEGZ, from, arrivals, indexqueuePtr, statsPtr);
+
+  } /* iterate over work queue */
+
+  return isPathFound;
+}
+
+
+/* =============================================================================
+ * expandToNeighborOrdered
+ * -- Same relaxation as expandToNeighbor, into a bucket queue keyed by cost
+ * -- The caller has already checked that the neighbor is inside the window
+ * =============================================================================
+ */
+static inline void expandToNeighborOrdered (grid_t* myGridPtr, long index, long value, momentum_t move, momentum_t fromArrival, unsigned char* arrivals, bucketqueue_t* bucketqueuePtr, router_stats_t* statsPtr){
+  long neighborValue = grid_getCell(myGridPtr, index);
+  if (neighborValue == GRID_POINT_FULL) {
+    return;
+  }
+  if (neighborValue == value) {
+    recordArrival(arrivals, index, move, fromArrival, FALSE);
+  } else if (neighborValue == GRID_POINT_EMPTY || value < neighborValue) {
+    grid_setCell(myGridPtr, index, value);
+    recordArrival(arrivals, index, move, fromArrival, TRUE);
+    bucketqueue_push(bucketqueuePtr, value, (uint32_t)index);
+    statsPtr->pushes++;
+  }
+}
+
+
+/* =============================================================================
+ * doExpansionOrdered
+ * -- Dijkstra over the grid with a bucket queue (Dial's algorithm): cells
+ *    leave the queue in cost order, so each one is expanded exactly once,
+ *    with its final cost; entries left behind by a cheaper relabel are
+ *    recognised by their key and dropped
+ * -- Neighbors are reached by stride, as in doExpansion
+ * =============================================================================
+ */
+static bool_t doExpansionOrdered (router_t* routerPtr, grid_t* myGridPtr, bucketqueue_t* bucketqueuePtr, unsigned char* arrivals, coordinate_t* srcPtr, coordinate_t* dstPtr, router_stats_t* statsPtr){
+  long xCost = routerPtr->xCost;
+  long yCost = routerPtr->yCost;
+  long zCost = routerPtr->zCost;
+
+  index_layout_t layout;
+  index_layout_init(&layout, myGridPtr);
+  long tileMask = layout.tileMask;
+  long zStride = layout.zStride;
+
+  long xMin = myGridPtr->xMin;
+  long xMax = myGridPtr->xMax;
+  long yMin = myGridPtr->yMin;
+  long yMax = myGridPtr->yMax;
+  long zMin = myGridPtr->zMin;
+  long zMax = myGridPtr->zMax;
+
+  bucketqueue_clear(bucketqueuePtr);
+  long srcIndex = index_layout_getIndex(&layout, srcPtr->x, srcPtr->y, srcPtr->z);
+  long dstIndex = index_layout_getIndex(&layout, dstPtr->x, dstPtr->y, dstPtr->z);
+  bucketqueue_push(bucketqueuePtr, 0, (uint32_t)srcIndex);
+  grid_setCell(myGridPtr, srcIndex, 0);
+  grid_setCell(myGridPtr, dstIndex, GRID_POINT_EMPTY);
+  if (arrivals) {
+    arrivals[srcIndex] = MOMENTUM_ZERO;
+  }
+  bool_t isPathFound = FALSE;
+
+  while (!bucketqueue_isEmpty(bucketqueuePtr)) {
+
+    long key;
+    long index = (long)bucketqueue_pop(bucketqueuePtr, &key);
+    if (index == dstIndex) {
+      isPathFound = TRUE;
+      break;
+    }
+
+    long value = grid_getCell(myGridPtr, index);
+    if (key != value) {
+      continue; /* stale */
+    }
+    statsPtr->expansions++;
+
+    long x;
+    long y;
+    long z;
+    index_layout_getPoint(&layout, (uint32_t)index, &x, &y, &z);
+    momentum_t from = (arrivals ? (momentum_t)arrivals[index] : MOMENTUM_ZERO);
+
+    long xNext = (((x & tileMask) != tileMask) ? layout.xStride : layout.xTileStride);
+    long xPrev = ((x & tileMask) ? layout.xStride : layout.xTileStride);
+    long yNext = (((y & tileMask) != tileMask) ? layout.yStride : layout.yTileStride);
+    long yPrev = ((y & tileMask) ? layout.yStride : layout.yTileStride);
+
+    if (x < xMax) expandToNeighborOrdered(myGridPtr, (index + xNext), (value + xCost), MOMENTUM_POSX, from, arrivals, bucketqueuePtr, statsPtr);
+    if (x > xMin) expandToNeighborOrdered(myGridPtr, (index - xPrev), (value + xCost), MOMENTUM_NEGX, from, arrivals, bucketqueuePtr, statsPtr);
+    if (y < yMax) expandToNeighborOrdered(myGridPtr, (index + yNext), (value + yCost), MOMENTUM_POSY, from, arrivals, bucketqueuePtr, statsPtr);
+    if (y > yMin) expandToNeighborOrdered(myGridPtr, (index - yPrev), (value + yCost), MOMENTUM_NEGY, from, arrivals, bucketqueuePtr, statsPtr);
+    if (z < zMax) expandToNeighborOrdered(myGridPtr, (index + zStride), (value + zCost), MOMENTUM_POSZ, from, arrivals, bucketqueuePtr, statsPtr);
+    if (z > zMin) expandToNeighborOrdered(myGridPtr, (index - zStride), (value + zCost), MOMENTUM_NEGZ, from, arrivals, bucketqueuePtr, statsPtr);
+
+  } /* iterate over bucket queue */
+
+  return isPathFound;
+}
+
+
+/* =============================================================================
+ * bitsetLog_beginLayer, bitsetLog_append, bitsetLog_find
+ * -- Entries of a layer are appended in plane word order, so they are found
+ *    by binary search
+ * =============================================================================
+ */
+static void bitsetLog_beginLayer (bitset_log_t* logPtr){
+  if (logPtr->numLayer == logPtr->layerCapacity) {
+    logPtr->layerCapacity = ((logPtr->layerCapacity > 0) ? (2 * logPtr->layerCapacity) : 256);
+    logPtr->layerStarts = (long*)realloc(logPtr->layerStarts, logPtr->layerCapacity * sizeof(long));
+    assert(logPtr->layerStarts);
+  }
+  logPtr->layerStarts[logPtr->numLayer++] = logPtr->numEntry;
+}
+
+static inline void bitsetLog_append (bitset_log_t* logPtr, long key, uint64_t bits){
+  if (logPtr->numEntry == logPtr->capacity) {
+    logPtr->capacity = ((logPtr->capacity > 0) ? (2 * logPtr->capacity) : 4096);
+    logPtr->keys = (long*)realloc(logPtr->keys, logPtr->capacity * sizeof(long));
+    logPtr->bits = (uint64_t*)realloc(logPtr->bits, logPtr->capacity * sizeof(uint64_t));
+    assert(logPtr->keys && logPtr->bits);
+  }
+  logPtr->keys[logPtr->numEntry] = key;
+  logPtr->bits[logPtr->numEntry] = bits;
+  logPtr->numEntry++;
+}
+
+static uint64_t* bitsetLog_find (bitset_log_t* logPtr, long layer, long key){
+  if (layer < 0 || layer >= logPtr->numLayer) {
+    return NULL;
+  }
+  long lo = logPtr->layerStarts[layer];
+  long hi = ((layer + 1 < logPtr->numLayer) ? logPtr->layerStarts[layer + 1] : logPtr->numEntry);
+  while (lo < hi) {
+    long mid = (lo + hi) / 2;
+    if (logPtr->keys[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (((lo < logPtr->numEntry) && (logPtr->keys[lo] == key)) ? &logPtr->bits[lo] : NULL);
+}
+
+
+/* =============================================================================
+ * doExpansionBitset
+ * -- Unit-cost breadth-first expansion on bit planes: a layer is computed a
+ *    whole 64-cell word at a time, shifting the previous layer along x and
+ *    OR-ing the rows next to it in y and z, then masking out occupied and
+ *    visited cells; the words reached are appended to the workspace's log
+ *    for doTracebackBitset, and the private grid is not touched
+ * -- Only used when the x/y/z costs are equal (main)
+ * =============================================================================
+ */
+static bool_t doExpansionBitset (grid_t* gridPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, coordinate_t* srcPtr, coordinate_t* dstPtr, router_stats_t* statsPtr){
+  const long WORD_BITS = GRID_OCCUPANCY_WORD_BITS;
+  long height = myGridPtr->height;
+  long numRow = height * myGridPtr->depth;
+  long rowWords = gridPtr->occupancyRowWords;
+  long stride = rowWords + 2; /* plane rows are padded with a zero word on each side */
+  uint64_t* visitedBits = workspacePtr->bitsPtr;
+  uint64_t* frontierBits = visitedBits + numRow * stride;
+  uint64_t* nextBits = frontierBits + numRow * stride;
+  const uint64_t* zeroRow = nextBits + numRow * stride;
+  unsigned char* frontierActive = (unsigned char*)(zeroRow + stride); /* rows holding any bit */
+  unsigned char* nextActive = frontierActive + numRow;
+  bitset_log_t* logPtr = &workspacePtr->bitsetLog;
+
+  long xMin = myGridPtr->xMin;
+  long xMax = myGridPtr->xMax;
+  long yMin = myGridPtr->yMin;
+  long yMax = myGridPtr->yMax;
+  long zMin = myGridPtr->zMin;
+  long zMax = myGridPtr->zMax;
+  long wMin = xMin / WORD_BITS;
+  long wMax = xMax / WORD_BITS;
+  uint64_t wMinMask = ~(uint64_t)0 << (xMin % WORD_BITS);
+  uint64_t wMaxMask = ~(uint64_t)0 >> (WORD_BITS - 1 - (xMax % WORD_BITS));
+
+  long y;
+  long z;
+  long w;
+  for (z = zMin; z <= zMax; z++) {
+    for (y = yMin; y <= yMax; y++) {
+      long first = (z * height + y) * stride + wMin;
+      long count = wMax - wMin + 3;
+      memset(&visitedBits[first], 0, (count * sizeof(uint64_t)));
+      memset(&frontierBits[first], 0, (count * sizeof(uint64_t)));
+      memset(&nextBits[first], 0, (count * sizeof(uint64_t)));
+      frontierActive[z * height + y] = 0;
+      nextActive[z * height + y] = 0;
+    }
+  }
+
+  long srcWord = (srcPtr->z * height + srcPtr->y) * stride + 1 + srcPtr->x / WORD_BITS;
+  long dstWord = (dstPtr->z * height + dstPtr->y) * stride + 1 + dstPtr->x / WORD_BITS;
+  uint64_t dstBit = (uint64_t)1 << (dstPtr->x % WORD_BITS);
+  frontierBits[srcWord] = (uint64_t)1 << (srcPtr->x % WORD_BITS);
+  visitedBits[srcWord] = frontierBits[srcWord];
+  frontierActive[srcPtr->z * height + srcPtr->y] = 1;
+  logPtr->numEntry = 0;
+  logPtr->numLayer = 0;
+  bitsetLog_beginLayer(logPtr);
+  bitsetLog_append(logPtr, srcWord, frontierBits[srcWord]);
+
+  /* rows the wave can have reached so far */
+  long yLo = srcPtr->y;
+  long yHi = srcPtr->y;
+  long zLo = srcPtr->z;
+  long zHi = srcPtr->z;
+  while (1) {
+
+    bitsetLog_beginLayer(logPtr);
+    yLo = MAX(yLo - 1, yMin);
+    yHi = MIN(yHi + 1, yMax);
+    zLo = MAX(zLo - 1, zMin);
+    zHi = MIN(zHi + 1, zMax);
+
+    bool_t isLayerEmpty = TRUE;
+    bool_t isPathFound = FALSE;
+
+    for (z = zLo; z <= zHi; z++) {
+      for (y = yLo; y <= yHi; y++) {
+        long r = z * height + y;
+        uint64_t* nextRow = &nextBits[r * stride];
+
+        /* nothing can reach a row whose own and surrounding frontier rows
+         * are empty; only its stale words from two layers ago need clearing */
+        if (!(frontierActive[r] |
+              ((y > yMin) ? frontierActive[r - 1] : 0) |
+              ((y < yMax) ? frontierActive[r + 1] : 0) |
+              ((z > zMin) ? frontierActive[r - height] : 0) |
+              ((z < zMax) ? frontierActive[r + height] : 0)))
+        {
+          if (nextActive[r]) {
+            memset(&nextRow[wMin + 1], 0, ((wMax - wMin + 1) * sizeof(uint64_t)));
+            nextActive[r] = 0;
+          }
+          continue;
+        }
+
+        const uint64_t* occupancyRow = grid_getOccupancyRow(gridPtr, y, z) - 1;
+        uint64_t* frontierRow = &frontierBits[r * stride];
+        uint64_t* visitedRow = &visitedBits[r * stride];
+        const uint64_t* yPrevRow = ((y > yMin) ? (frontierRow - stride) : zeroRow);
+        const uint64_t* yNextRow = ((y < yMax) ? (frontierRow + stride) : zeroRow);
+        const uint64_t* zPrevRow = ((z > zMin) ? (frontierRow - height * stride) : zeroRow);
+        const uint64_t* zNextRow = ((z < zMax) ? (frontierRow + height * stride) : zeroRow);
+        unsigned char isRowActive = 0;
+
+        for (w = wMin + 1; w <= wMax + 1; w++) {
+          uint64_t f = frontierRow[w];
+          uint64_t reach = ((f << 1) | (f >> 1) |
+                            (frontierRow[w - 1] >> (WORD_BITS - 1)) |
+                            (frontierRow[w + 1] << (WORD_BITS - 1)) |
+                            yPrevRow[w] | yNextRow[w] | zPrevRow[w] | zNextRow[w]);
+
+          /* sources and destinations are occupied: let this net's dst in */
+          uint64_t blocked = __atomic_load_n(&occupancyRow[w], __ATOMIC_RELAXED);
+          if ((r * stride + w) == dstWord) {
+            blocked &= ~dstBit;
+          }
+          if (w == wMin + 1) {
+            reach &= wMinMask;
+          }
+          if (w == wMax + 1) {
+            reach &= wMaxMask;
+          }
+          reach &= ~(blocked | visitedRow[w]);
+          nextRow[w] = reach;
+          if (reach == 0) {
+            continue;
+          }
+
+          isRowActive = 1;
+          visitedRow[w] |= reach;
+          if ((r * stride + w) == dstWord && (reach & dstBit)) {
+            isPathFound = TRUE;
+          }
+          bitsetLog_append(logPtr, (r * stride + w), reach);
+          long numReached = __builtin_popcountll(reach);
+          statsPtr->pushes += numReached;
+          statsPtr->expansions += numReached;
+        }
+
+        nextActive[r] = isRowActive;
+        if (isRowActive) {
+          isLayerEmpty = FALSE;
+        }
+      }
+    }
+
+    if (isPathFound) {
+      return TRUE;
+    }
+    if (isLayerEmpty) {
+      return FALSE;
+    }
+
+    uint64_t* tmpBits = frontierBits;
+    frontierBits = nextBits;
+    nextBits = tmpBits;
+    unsigned char* tmpActive = frontierActive;
+    frontierActive = nextActive;
+    nextActive = tmpActive;
+  }
+}
+
+
+/* =============================================================================
+ * relaxAlongX
+ * -- Forward then backward pass over a row for the moves within it; each
+ *    step depends on the previous one, so this part stays scalar
+ * =============================================================================
+ */
+static bool_t relaxAlongX (int32_t* dist, const int32_t* wall, long n, int32_t cost){
+  bool_t isChanged = FALSE;
+  long i;
+  for (i = 1; i < n; i++) {
+    int32_t candidate = MAX((dist[i - 1] + cost), wall[i]);
+    if (candidate < dist[i]) {
+      dist[i] = candidate;
+      isChanged = TRUE;
+    }
+  }
+  for (i = n - 2; i >= 0; i--) {
+    int32_t candidate = MAX((dist[i + 1] + cost), wall[i]);
+    if (candidate < dist[i]) {
+      dist[i] = candidate;
+      isChanged = TRUE;
+    }
+  }
+  return isChanged;
+}
+
+
+/* =============================================================================
+ * doExpansionSweep
+ * -- Computes the whole cost field of the window at once: a forward and a
+ *    backward sweep over the rows, each relaxing a row against the one
+ *    before it in y and in z with the vector row kernel, then along x, are
+ *    repeated until nothing changes; every reached point is then labelled
+ *    with its cost, so doTraceback works unchanged
+ * -- The sweep arrays are row-major whatever the layout of the grid
+ * -- Suits boards where the wavefront is broad: the work per sweep is the
+ *    size of the window, whatever the shape of the front
+ * =============================================================================
+ */
+static bool_t doExpansionSweep (router_t* routerPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, coordinate_t* srcPtr, coordinate_t* dstPtr, router_stats_t* statsPtr){
+  int32_t xCost = (int32_t)routerPtr->xCost;
+  int32_t yCost = (int32_t)routerPtr->yCost;
+  int32_t zCost = (int32_t)routerPtr->zCost;
+  int32_t* dist = workspacePtr->sweepDistPtr;
+  int32_t* wall = workspacePtr->sweepWallPtr;
+  relax_row_t relaxRow = workspacePtr->relaxRow;
+  index_layout_t layout;
+  index_layout_init(&layout, myGridPtr);
+
+  long width = myGridPtr->width;
+  long area = myGridPtr->width * myGridPtr->height;
+  long xMin = myGridPtr->xMin;
+  long xMax = myGridPtr->xMax;
+  long yMin = myGridPtr->yMin;
+  long yMax = myGridPtr->yMax;
+  long zMin = myGridPtr->zMin;
+  long zMax = myGridPtr->zMax;
+  long rowLength = xMax - xMin + 1;
+  long numCell = rowLength * (yMax - yMin + 1) * (zMax - zMin + 1);
+
+  long srcIndex = srcPtr->z * area + srcPtr->y * width + srcPtr->x;
+  long dstIndex = dstPtr->z * area + dstPtr->y * width + dstPtr->x;
+
+  long x;
+  long y;
+  long z;
+  for (z = zMin; z <= zMax; z++) {
+    for (y = yMin; y <= yMax; y++) {
+      long first = z * area + y * width;
+      for (x = xMin; x <= xMax; x++) {
+        long index = first + x;
+        /* sources and destinations are full: let this net's dst in */
+        long value = grid_getCell(myGridPtr, index_layout_getIndex(&layout, x, y, z));
+        bool_t isWall = (value == GRID_POINT_FULL && index != dstIndex);
+        wall[index] = (isWall ? RELAX_INFINITY : 0);
+        dist[index] = RELAX_INFINITY;
+      }
+    }
+  }
+  dist[srcIndex] = 0;
+
+  bool_t isChanged;
+  do {
+    isChanged = FALSE;
+
+    for (z = zMin; z <= zMax; z++) {
+      for (y = yMin; y <= yMax; y++) {
+        long first = z * area + y * width + xMin;
+        if (y > yMin && relaxRow(&dist[first], &dist[first - width], &wall[first], rowLength, yCost)) {
+          isChanged = TRUE;
+        }
+        if (z > zMin && relaxRow(&dist[first], &dist[first - area], &wall[first], rowLength, zCost)) {
+          isChanged = TRUE;
+        }
+        if (relaxAlongX(&dist[first], &wall[first], rowLength, xCost)) {
+          isChanged = TRUE;
+        }
+      }
+    }
+
+    for (z = zMax; z >= zMin; z--) {
+      for (y = yMax; y >= yMin; y--) {
+        long first = z * area + y * width + xMin;
+        if (y < yMax && relaxRow(&dist[first], &dist[first + width], &wall[first], rowLength, yCost)) {
+          isChanged = TRUE;
+        }
+        if (z < zMax && relaxRow(&dist[first], &dist[first + area], &wall[first], rowLength, zCost)) {
+          isChanged = TRUE;
+        }
+        if (relaxAlongX(&dist[first], &wall[first], rowLength, xCost)) {
+          isChanged = TRUE;
+        }
+      }
+    }
+
+    statsPtr->expansions += 2 * numCell;
+  } while (isChanged);
+
+  if (dist[dstIndex] >= RELAX_INFINITY) {
+    return FALSE;
+  }
+
+  for (z = zMin; z <= zMax; z++) {
+    for (y = yMin; y <= yMax; y++) {
+      long first = z * area + y * width;
+      for (x = xMin; x <= xMax; x++) {
+        long index = first + x;
+        if (dist[index] < RELAX_INFINITY) {
+          grid_setCell(myGridPtr, index_layout_getIndex(&layout, x, y, z), dist[index]);
+          statsPtr->pushes++;
+        }
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * router_delta_t
+ * -- Delta-stepping (Meyer and Sanders) over buckets of delta cost units,
+ *    delta being the smallest move cost: every move out of a bucket lands
+ *    in a later one, so each bucket is settled in a single parallel pass
+ *    and the team only meets twice per bucket
+ * -- The points of a bucket are claimed in chunks by the members of the
+ *    team, and their neighbors relaxed with a compare-and-swap on a packed
+ *    (epoch, settled, cost) word, so nothing has to be cleared between nets
+ * -- A bucket is stored in blocks of DELTA_BLOCK entries, allocated as the
+ *    frontier first needs them and kept for later nets, so a team only
+ *    holds as much as its widest bucket so far
+ * =============================================================================
+ */
+#define DELTA_SETTLED (1UL << 31)
+#define DELTA_COST_MASK (DELTA_SETTLED - 1)
+
+enum delta_config {
+  DELTA_CHUNK = 64,   /* bucket entries claimed at a time */
+  DELTA_SPIN = 1024,  /* barrier polls before yielding the processor */
+  DELTA_BLOCK_BITS = 12,
+  DELTA_BLOCK = (1 << DELTA_BLOCK_BITS), /* bucket entries per block */
+};
+
+typedef struct router_delta {
+  index_layout_t layout;
+  grid_t* gridPtr;       /* walls are read from the shared grid... */
+  grid_t* myGridPtr;     /* ...and the settled costs written to the leader's */
+  uint64_t* states;      /* per point: epoch << 32 | settled << 31 | cost */
+  uint32_t epoch;
+  uint32_t** blocks;     /* numBucket slots of numBlock blocks of point indices, used as a ring */
+  long numBlock;         /* per slot, enough for numCell entries */
+  long* bucketSizes;
+  long numBucket;
+  long numCell;
+  long delta;
+  long xCost;
+  long yCost;
+  long zCost;
+  long srcIndex;
+  long dstIndex;
+  long current;          /* bucket being settled */
+  long nextEntry;        /* of the current bucket, first not yet claimed */
+  bool_t isDone;
+  bool_t isPathFound;
+  router_crew_t* crewPtr; /* to recruit from between buckets, NULL if none */
+  bool_t isLateJoin;     /* the helpers reserved join past the first bucket */
+  long numMember;        /* leader included */
+  long numSlotLeft;      /* helpers reserved that have not joined yet */
+  long numActive;        /* members that may still read the team */
+  long numArrived;       /* at the barrier */
+  unsigned long generation; /* of the barrier */
+  struct router_delta* nextPtr; /* among the crew's teams with free slots */
+} router_delta_t;
+
+struct router_crew {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  long numThread;
+  long numRouting;       /* threads still taking nets from the work queue */
+  long numIdle;          /* threads waiting to join a team */
+  router_delta_t* openPtr;
+};
+
+
+/* =============================================================================
+ * delta_alloc
+ * =============================================================================
+ */
+static router_delta_t* delta_alloc (router_t* routerPtr, grid_t* gridPtr){
+  long minCost = MIN(routerPtr->xCost, MIN(routerPtr->yCost, routerPtr->zCost));
+  long maxCost = MAX(routerPtr->xCost, MAX(routerPtr->yCost, routerPtr->zCost));
+  /* costs must fit below the settled bit, indices the 32-bit bucket entries */
+  assert(minCost > 0);
+  assert((routerPtr->xCost + routerPtr->yCost + routerPtr->zCost) * gridPtr->numCell < (long)DELTA_SETTLED);
+  assert(gridPtr->numCell <= ((long)UINT32_MAX + 1));
+
+  router_delta_t* deltaPtr = (router_delta_t*)calloc(1, sizeof(router_delta_t));
+  assert(deltaPtr);
+  deltaPtr->numCell = gridPtr->numCell;
+  deltaPtr->delta = minCost;
+  /* relaxations reach at most maxCost / delta buckets past the current one */
+  deltaPtr->numBucket = maxCost / minCost + 2;
+  deltaPtr->states = (uint64_t*)calloc(deltaPtr->numCell, sizeof(uint64_t));
+  deltaPtr->numBlock = (deltaPtr->numCell + DELTA_BLOCK - 1) >> DELTA_BLOCK_BITS;
+  deltaPtr->blocks = (uint32_t**)calloc(deltaPtr->numBucket * deltaPtr->numBlock, sizeof(uint32_t*));
+  deltaPtr->bucketSizes = (long*)calloc(deltaPtr->numBucket, sizeof(long));
+  assert(deltaPtr->states && deltaPtr->blocks && deltaPtr->bucketSizes);
+  deltaPtr->xCost = routerPtr->xCost;
+  deltaPtr->yCost = routerPtr->yCost;
+  deltaPtr->zCost = routerPtr->zCost;
+
+  return deltaPtr;
+}
+
+
+/* =============================================================================
+ * delta_free
+ * =============================================================================
+ */
+static void delta_free (router_delta_t* deltaPtr){
+  long b;
+  for (b = 0; b < deltaPtr->numBucket * deltaPtr->numBlock; b++) {
+    free(deltaPtr->blocks[b]);
+  }
+  free(deltaPtr->states);
+  free(deltaPtr->blocks);
+  free(deltaPtr->bucketSizes);
+  free(deltaPtr);
+}
+
+
+/* =============================================================================
+ * delta_entryRef
+ * -- Entry of a bucket slot, allocating its block if no member did yet
+ * =============================================================================
+ */
+static inline uint32_t* delta_entryRef (router_delta_t* deltaPtr, long slot, long entry){
+  uint32_t** blockPtrPtr = &deltaPtr->blocks[slot * deltaPtr->numBlock + (entry >> DELTA_BLOCK_BITS)];
+  uint32_t* block = __atomic_load_n(blockPtrPtr, __ATOMIC_ACQUIRE);
+  if (block == NULL) {
+    uint32_t* newBlock = (uint32_t*)malloc(DELTA_BLOCK * sizeof(uint32_t));
+    assert(newBlock);
+    if (__atomic_compare_exchange_n(blockPtrPtr, &block, newBlock, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      block = newBlock;
+    } else {
+      free(newBlock); /* another member got there first */
+    }
+  }
+  return &block[entry & (DELTA_BLOCK - 1)];
+}
+
+
+/* =============================================================================
+ * delta_setup
+ * -- Prepares the team's expansion of a net, with the leader alone in it
+ * =============================================================================
+ */
+static void delta_setup (router_delta_t* deltaPtr, router_crew_t* crewPtr, grid_t* gridPtr, grid_t* myGridPtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
+  if (++deltaPtr->epoch == 0) {
+    memset(deltaPtr->states, 0, (deltaPtr->numCell * sizeof(uint64_t)));
+    deltaPtr->epoch = 1;
+  }
+  index_layout_init(&deltaPtr->layout, myGridPtr);
+  deltaPtr->gridPtr = gridPtr;
+  deltaPtr->myGridPtr = myGridPtr;
+  memset(deltaPtr->bucketSizes, 0, (deltaPtr->numBucket * sizeof(long)));
+
+  deltaPtr->srcIndex = index_layout_getIndex(&deltaPtr->layout, srcPtr->x, srcPtr->y, srcPtr->z);
+  deltaPtr->dstIndex = index_layout_getIndex(&deltaPtr->layout, dstPtr->x, dstPtr->y, dstPtr->z);
+  deltaPtr->states[deltaPtr->srcIndex] = ((uint64_t)deltaPtr->epoch << 32);
+  *delta_entryRef(deltaPtr, 0, 0) = (uint32_t)deltaPtr->srcIndex;
+  deltaPtr->bucketSizes[0] = 1;
+
+  deltaPtr->current = 0;
+  deltaPtr->nextEntry = 0;
+  deltaPtr->isDone = FALSE;
+  deltaPtr->isPathFound = FALSE;
+  deltaPtr->crewPtr = crewPtr;
+  deltaPtr->isLateJoin = FALSE;
+  deltaPtr->numMember = 1;
+  deltaPtr->numSlotLeft = 0;
+  deltaPtr->numActive = 1;
+  deltaPtr->numArrived = 0;
+}
+
+
+/* =============================================================================
+ * delta_wait
+ * -- Barrier of the team; members that find it closed spin, then yield
+ * =============================================================================
+ */
+static void delta_wait (router_delta_t* deltaPtr){
+  unsigned long generation = __atomic_load_n(&deltaPtr->generation, __ATOMIC_ACQUIRE);
+  if (__atomic_add_fetch(&deltaPtr->numArrived, 1, __ATOMIC_ACQ_REL) == __atomic_load_n(&deltaPtr->numMember, __ATOMIC_ACQUIRE)) {
+    __atomic_store_n(&deltaPtr->numArrived, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&deltaPtr->generation, (generation + 1), __ATOMIC_RELEASE);
+    return;
+  }
+
+  long numPoll = 0;
+  while (__atomic_load_n(&deltaPtr->generation, __ATOMIC_ACQUIRE) == generation) {
+    if (++numPoll > DELTA_SPIN) {
+      sched_yield();
+    }
+  }
+}
+
+
+/* =============================================================================
+ * delta_relax
+ * -- Lowers the cost of a point, queueing it in the bucket of its new cost
+ *    unless it already sits there
+ * =============================================================================
+ */
+static inline void delta_relax (router_delta_t* deltaPtr, long index, long cost, router_stats_t* statsPtr){
+  uint64_t epochBits = ((uint64_t)deltaPtr->epoch << 32);
+  uint64_t state = __atomic_load_n(&deltaPtr->states[index], __ATOMIC_RELAXED);
+  bool_t isLabelled;
+
+  while (1) {
+    isLabelled = ((state >> 32) == deltaPtr->epoch);
+    if (isLabelled && ((state & DELTA_SETTLED) || (long)(state & DELTA_COST_MASK) <= cost)) {
+      return;
+    }
+    if (__atomic_compare_exchange_n(&deltaPtr->states[index], &state, (epochBits | (uint64_t)cost),
+                                    TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  long bucket = cost / deltaPtr->delta;
+  if (!isLabelled || (long)(state & DELTA_COST_MASK) / deltaPtr->delta != bucket) {
+    long slot = bucket % deltaPtr->numBucket;
+    long entry = __atomic_fetch_add(&deltaPtr->bucketSizes[slot], 1, __ATOMIC_RELAXED);
+    *delta_entryRef(deltaPtr, slot, entry) = (uint32_t)index;
+    statsPtr->pushes++;
+  }
+}
+
+
+/* =============================================================================
+ * delta_settle
+ * -- Expands a point of the current bucket, unless another member already
+ *    did or it has since moved to an earlier bucket
+ * =============================================================================
+ */
+static void delta_settle (router_delta_t* deltaPtr, long index, router_stats_t* statsPtr){
+  uint64_t state = __atomic_load_n(&deltaPtr->states[index], __ATOMIC_RELAXED);
+  if ((state & DELTA_SETTLED) ||
+      !__atomic_compare_exchange_n(&deltaPtr->states[index], &state, (state | DELTA_SETTLED),
+                                   FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+    return;
+  }
+
+  /* costs in the current bucket can no longer drop: this one is final */
+  long cost = (long)(state & DELTA_COST_MASK);
+  grid_setCell(deltaPtr->myGridPtr, index, cost);
+  statsPtr->expansions++;
+  if (index == deltaPtr->dstIndex) {
+    return;
+  }
+
+  grid_t* myGridPtr = deltaPtr->myGridPtr;
+  index_layout_t* layoutPtr = &deltaPtr->layout;
+  long tileMask = layoutPtr->tileMask;
+  long x;
+  long y;
+  long z;
+  index_layout_getPoint(layoutPtr, (uint32_t)index, &x, &y, &z);
+
+  long neighbors[6];
+  long moveCosts[6];
+  long numNeighbor = 0;
+  if (x < myGridPtr->xMax) {
+    neighbors[numNeighbor] = index + (((x & tileMask) != tileMask) ? layoutPtr->xStride : layoutPtr->xTileStride);
+    moveCosts[numNeighbor++] = deltaPtr->xCost;
+  }
+  if (x > myGridPtr->xMin) {
+    neighbors[numNeighbor] = index - ((x & tileMask) ? layoutPtr->xStride : layoutPtr->xTileStride);
+    moveCosts[numNeighbor++] = deltaPtr->xCost;
+  }
+  if (y < myGridPtr->yMax) {
+    neighbors[numNeighbor] = index + (((y & tileMask) != tileMask) ? layoutPtr->yStride : layoutPtr->yTileStride);
+    moveCosts[numNeighbor++] = deltaPtr->yCost;
+  }
+  if (y > myGridPtr->yMin) {
+    neighbors[numNeighbor] = index - ((y & tileMask) ? layoutPtr->yStride : layoutPtr->yTileStride);
+    moveCosts[numNeighbor++] = deltaPtr->yCost;
+  }
+  if (z < myGridPtr->zMax) {
+    neighbors[numNeighbor] = index + layoutPtr->zStride;
+    moveCosts[numNeighbor++] = deltaPtr->zCost;
+  }
+  if (z > myGridPtr->zMin) {
+    neighbors[numNeighbor] = index - layoutPtr->zStride;
+    moveCosts[numNeighbor++] = deltaPtr->zCost;
+  }
+
+  long i;
+  for (i = 0; i < numNeighbor; i++) {
+    long neighborIndex = neighbors[i];
+    /* sources and destinations are full: let this net's dst in */
+    if (neighborIndex != deltaPtr->dstIndex &&
+        grid_getCell(deltaPtr->gridPtr, neighborIndex) == GRID_POINT_FULL) {
+      continue;
+    }
+    delta_relax(deltaPtr, neighborIndex, (cost + moveCosts[i]), statsPtr);
+  }
+}
+
+
+/* =============================================================================
+ * crew_hasIdle
+ * -- Unlocked peek, to avoid setting up teams nobody can join
+ * =============================================================================
+ */
+static inline bool_t crew_hasIdle (router_crew_t* crewPtr){
+  return ((crewPtr && __atomic_load_n(&crewPtr->numIdle, __ATOMIC_RELAXED) > 0) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * crew_recruit
+ * -- Reserves every idle thread for the leader's team and opens it to them
+ * -- Before the expansion, helpers start with the first bucket; later they
+ *    are recruited by the leader between buckets, and join at the barrier
+ *    the other members are waiting at
+ * -- Returns the number of helpers reserved
+ * =============================================================================
+ */
+static long crew_recruit (router_crew_t* crewPtr, router_delta_t* deltaPtr, bool_t isLateJoin){
+  if (crewPtr == NULL) {
+    return 0;
+  }
+
+  Pthread_mutex_lock(abort_exec, "crew_recruit: failed to lock crew", &crewPtr->mutex);
+  long numHelper = crewPtr->numIdle;
+  if (numHelper > 0) {
+    crewPtr->numIdle = 0;
+    __atomic_store_n(&deltaPtr->numMember, (deltaPtr->numMember + numHelper), __ATOMIC_RELEASE);
+    __atomic_fetch_add(&deltaPtr->numActive, numHelper, __ATOMIC_RELAXED);
+    deltaPtr->numSlotLeft = numHelper;
+    deltaPtr->isLateJoin = isLateJoin;
+    deltaPtr->nextPtr = crewPtr->openPtr;
+    crewPtr->openPtr = deltaPtr;
+    Pthread_cond_broadcast(abort_exec, "crew_recruit: failed to wake crew", &crewPtr->cond);
+  }
+  Pthread_mutex_unlock(abort_exec, "crew_recruit: failed to unlock crew", &crewPtr->mutex);
+
+  return numHelper;
+}
+
+
+/* =============================================================================
+ * delta_advance
+ * -- Run by the leader between buckets: moves on to the next non-empty
+ *    bucket, or ends the expansion
+ * -- The other members are all at the barrier, so threads that ran out of
+ *    nets since the last bucket can be let in
+ * =============================================================================
+ */
+static void delta_advance (router_delta_t* deltaPtr){
+  deltaPtr->bucketSizes[deltaPtr->current % deltaPtr->numBucket] = 0;
+  deltaPtr->nextEntry = 0;
+
+  if (deltaPtr->states[deltaPtr->dstIndex] & DELTA_SETTLED &&
+      (deltaPtr->states[deltaPtr->dstIndex] >> 32) == deltaPtr->epoch)
+  {
+    deltaPtr->isDone = TRUE;
+    deltaPtr->isPathFound = TRUE;
+    return;
+  }
+
+  long bucket;
+  for (bucket = deltaPtr->current + 1; bucket < deltaPtr->current + deltaPtr->numBucket; bucket++) {
+    if (deltaPtr->bucketSizes[bucket % deltaPtr->numBucket] > 0) {
+      deltaPtr->current = bucket;
+      if (crew_hasIdle(deltaPtr->crewPtr)) {
+        crew_recruit(deltaPtr->crewPtr, deltaPtr, TRUE);
+      }
+      return;
+    }
+  }
+  deltaPtr->isDone = TRUE; /* nothing left to expand: dst is walled off */
+}
+
+
+/* =============================================================================
+ * delta_expand
+ * -- Body of every member of the team, the leader included; once it
+ *    returns a helper no longer touches the team
+ * -- Returns TRUE if dst was reached
+ * =============================================================================
+ */
+static bool_t delta_expand (router_delta_t* deltaPtr, bool_t isLeader, bool_t isLateJoin, router_stats_t* statsPtr){
+  while (1) {
+
+    /* recruited by delta_advance: the next bucket is picked already */
+    if (!isLateJoin) {
+      long slot = deltaPtr->current % deltaPtr->numBucket;
+      /* every block of the bucket was allocated before the barrier */
+      uint32_t** blocks = &deltaPtr->blocks[slot * deltaPtr->numBlock];
+      long numEntry = __atomic_load_n(&deltaPtr->bucketSizes[slot], __ATOMIC_RELAXED);
+      while (1) {
+        long first = __atomic_fetch_add(&deltaPtr->nextEntry, DELTA_CHUNK, __ATOMIC_RELAXED);
+        if (first >= numEntry) {
+          break;
+        }
+        long last = MIN((first + DELTA_CHUNK), numEntry);
+        long e;
+        for (e = first; e < last; e++) {
+          delta_settle(deltaPtr, (long)blocks[e >> DELTA_BLOCK_BITS][e & (DELTA_BLOCK - 1)], statsPtr);
+        }
+      }
+
+      delta_wait(deltaPtr);
+      if (isLeader) {
+        delta_advance(deltaPtr);
+      }
+    }
+    isLateJoin = FALSE;
+    delta_wait(deltaPtr);
+
+    if (deltaPtr->isDone) {
+      break;
+    }
+  }
+
+  bool_t isPathFound = deltaPtr->isPathFound;
+  if (!isLeader) {
+    __atomic_fetch_sub(&deltaPtr->numActive, 1, __ATOMIC_RELEASE);
+  }
+  return isPathFound;
+}
+
+
+/* =============================================================================
+ * router_crew_alloc
+ * =============================================================================
+ */
+router_crew_t* router_crew_alloc (long numThread){
+  router_crew_t* crewPtr = (router_crew_t*)malloc(sizeof(router_crew_t));
+  if (crewPtr) {
+    Pthread_mutex_init(abort_exec, "router_crew_alloc: failed to initialize mutex", &crewPtr->mutex, NULL);
+    Pthread_cond_init(abort_exec, "router_crew_alloc: failed to initialize condition", &crewPtr->cond, NULL);
+    crewPtr->numThread = numThread;
+    crewPtr->numRouting = numThread;
+    crewPtr->numIdle = 0;
+    crewPtr->openPtr = NULL;
+  }
+
+  return crewPtr;
+}
+
+
+/* =============================================================================
+ * router_crew_free
+ * =============================================================================
+ */
+void router_crew_free (router_crew_t* crewPtr){
+  Pthread_mutex_destroy(print_error, "router_crew_free: failed to destroy mutex", &crewPtr->mutex);
+  Pthread_cond_destroy(print_error, "router_crew_free: failed to destroy condition", &crewPtr->cond);
+  free(crewPtr);
+}
+
+
+/* =============================================================================
+ * crew_isTail
+ * -- TRUE if, with numQueued nets left in the work queue, the threads
+ *    cannot all get one
+ * =============================================================================
+ */
+static inline bool_t crew_isTail (router_crew_t* crewPtr, long numQueued){
+  return ((crewPtr && numQueued < crewPtr->numThread - 1) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * crew_dismiss
+ * -- Waits for the helpers of the leader's team to let go of it
+ * =============================================================================
+ */
+static void crew_dismiss (router_delta_t* deltaPtr){
+  /* helpers join before the barrier after they were reserved: the team is no longer open */
+  long numPoll = 0;
+  while (__atomic_load_n(&deltaPtr->numActive, __ATOMIC_ACQUIRE) > 1) {
+    if (++numPoll > DELTA_SPIN) {
+      sched_yield();
+    }
+  }
+}
+
+
+/* =============================================================================
+ * crew_help
+ * -- Run by a thread once the work queue is empty: joins the teams of the
+ *    threads still routing, until none is left
+ * =============================================================================
+ */
+static void crew_help (router_crew_t* crewPtr, router_stats_t* statsPtr){
+  Pthread_mutex_lock(abort_exec, "crew_help: failed to lock crew", &crewPtr->mutex);
+  crewPtr->numRouting--;
+  crewPtr->numIdle++;
+  if (crewPtr->numRouting == 0) {
+    Pthread_cond_broadcast(abort_exec, "crew_help: failed to wake crew", &crewPtr->cond);
+  }
+
+  while (1) {
+    router_delta_t* deltaPtr = crewPtr->openPtr;
+    if (deltaPtr) {
+      /* this thread was reserved by some team: take a slot in the first one */
+      bool_t isLateJoin = deltaPtr->isLateJoin;
+      if (--deltaPtr->numSlotLeft == 0) {
+        crewPtr->openPtr = deltaPtr->nextPtr;
+      }
+      Pthread_mutex_unlock(abort_exec, "crew_help: failed to unlock crew", &crewPtr->mutex);
+      statsPtr->joins++;
+      delta_expand(deltaPtr, FALSE, isLateJoin, statsPtr);
+      Pthread_mutex_lock(abort_exec, "crew_help: failed to lock crew", &crewPtr->mutex);
+      crewPtr->numIdle++;
+    } else if (crewPtr->numRouting == 0) {
+      break;
+    } else {
+      Pthread_cond_wait(abort_exec, "crew_help: failed to wait for crew", &crewPtr->cond, &crewPtr->mutex);
+    }
+  }
+
+  Pthread_mutex_unlock(abort_exec, "crew_help: failed to unlock crew", &crewPtr->mutex);
+}
+
+
+/* =============================================================================
+ * waveValue
+ * -- Cost label of a cell as seen by the given wave, -1 if that wave never
+ *    reached it (empty, full or labelled by the opposite wave)
+ * =============================================================================
+ */
+static inline long waveValue (long gridValue, wave_t wave){
+  if (wave == WAVE_SRC) {
+    return ((gridValue >= 0) ? gridValue : -1);
+  }
+  return ((gridValue <= DST_WAVE_BASE) ? (DST_WAVE_BASE - gridValue) : -1);
+}
+
+
+/* =============================================================================
+ * expandWaveToNeighbor
+ * -- Returns TRUE if the neighbor was already reached by the opposite wave,
+ *    storing the cost of the path through it in meetCostPtr
+ * =============================================================================
+ */
+static bool_t expandWaveToNeighbor (grid_t* myGridPtr, long x, long y, long z, long value, wave_t wave, queue_t* queuePtr, long* frontierPtr, long* meetCostPtr, router_stats_t* statsPtr){
+  if (!grid_isPointValid(myGridPtr, x, y, z)) {
+    return FALSE;
+  }
+
+  long index = grid_getPointIndex(myGridPtr, x, y, z);
+  long neighborValue = grid_getCell(myGridPtr, index);
+  if (neighborValue == GRID_POINT_FULL) {
+    return FALSE;
+  }
+
+  long otherValue = waveValue(neighborValue, ((wave == WAVE_SRC) ? WAVE_DST : WAVE_SRC));
+  if (otherValue >= 0) {
+    (*meetCostPtr) = value + otherValue;
+    return TRUE;
+  }
+
+  long ownValue = waveValue(neighborValue, wave);
+  if (ownValue < 0 || value < ownValue) {
+    grid_setCell(myGridPtr, index, ((wave == WAVE_SRC) ? value : (DST_WAVE_BASE - value)));
+    queue_push(queuePtr, INDEX_TO_DATA(index));
+    (*frontierPtr)++;
+    statsPtr->pushes++;
+    if (ownValue >= 0) {
+      statsPtr->reexpansions++;
+    }
+  }
+
+  return FALSE;
+}
+
+
+/* =============================================================================
+ * doExpansionBidirectional
+ * -- Grows a wave from each end, always advancing the smaller frontier, and
+ *    stops as soon as they touch; the cheapest touching edge found around
+ *    that cell is returned in (srcSidePtr, dstSidePtr)
+ * =============================================================================
+ */
+static bool_t doExpansionBidirectional (router_t* routerPtr, grid_t* myGridPtr, queue_t* srcQueuePtr, queue_t* dstQueuePtr, coordinate_t* srcPtr, coordinate_t* dstPtr, coordinate_t* srcSidePtr, coordinate_t* dstSidePtr, router_stats_t* statsPtr){
+  point_t* moves[] = {&MOVE_POSX, &MOVE_NEGX, &MOVE_POSY, &MOVE_NEGY, &MOVE_POSZ, &MOVE_NEGZ};
+  long moveCosts[] = {
+    routerPtr->xCost, routerPtr->xCost,
+    routerPtr->yCost, routerPtr->yCost,
+    routerPtr->zCost, routerPtr->zCost
+  };
+
+  index_layout_t layout;
+  index_layout_init(&layout, myGridPtr);
+
+  queue_clear(srcQueuePtr);
+  queue_clear(dstQueuePtr);
+  long srcIndex = grid_getPointIndex(myGridPtr, srcPtr->x, srcPtr->y, srcPtr->z);
+  long dstIndex = grid_getPointIndex(myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z);
+  grid_setCell(myGridPtr, srcIndex, 0);
+  grid_setCell(myGridPtr, dstIndex, DST_WAVE_BASE);
+  queue_push(srcQueuePtr, INDEX_TO_DATA(srcIndex));
+  queue_push(dstQueuePtr, INDEX_TO_DATA(dstIndex));
+  long srcFrontier = 1;
+  long dstFrontier = 1;
+
+  while (srcFrontier > 0 && dstFrontier > 0) {
+
+    wave_t wave = ((srcFrontier <= dstFrontier) ? WAVE_SRC : WAVE_DST);
+    queue_t* queuePtr = ((wave == WAVE_SRC) ? srcQueuePtr : dstQueuePtr);
+    long* frontierPtr = ((wave == WAVE_SRC) ? &srcFrontier : &dstFrontier);
+
+    long index = DATA_TO_INDEX(queue_pop(queuePtr));
+    (*frontierPtr)--;
+
+    long x;
+    long y;
+    long z;
+    index_layout_getPoint(&layout, (uint32_t)index, &x, &y, &z);
+    long value = waveValue(grid_getCell(myGridPtr, index), wave);
+    statsPtr->expansions++;
+
+    long bestMeetCost = -1;
+    long i;
+    for (i = 0; i < 6; i++) {
+      long nx = x + moves[i]->x;
+      long ny = y + moves[i]->y;
+      long nz = z + moves[i]->z;
+      long meetCost;
+      if (expandWaveToNeighbor(myGridPtr, nx, ny, nz, (value + moveCosts[i]), wave, queuePtr, frontierPtr, &meetCost, statsPtr)) {
+        if (bestMeetCost < 0 || meetCost < bestMeetCost) {
+          bestMeetCost = meetCost;
+          coordinate_t* ownSidePtr = ((wave == WAVE_SRC) ? srcSidePtr : dstSidePtr);
+          coordinate_t* otherSidePtr = ((wave == WAVE_SRC) ? dstSidePtr : srcSidePtr);
+          ownSidePtr->x = x;
+          ownSidePtr->y = y;
+          ownSidePtr->z = z;
+          otherSidePtr->x = nx;
+          otherSidePtr->y = ny;
+          otherSidePtr->z = nz;
+        }
+      }
+    }
+
+    if (bestMeetCost >= 0) {
+      return TRUE;
+    }
+
+  } /* iterate until one wave runs out */
+
+  return FALSE;
+}
+
+
+/* =============================================================================
+ * estimateCost
+ * -- Lower bound of the cost of going from (x, y, z) to dst: no path can
+ *    take fewer moves along each axis than the manhattan distance, so this
+ *    is admissible and, since every move changes it by at most its own cost,
+ *    consistent as well
+ * =============================================================================
+ */
+static inline long estimateCost (router_t* routerPtr, long x, long y, long z, coordinate_t* dstPtr){
+  return routerPtr->xCost * labs(x - dstPtr->x) +
+         routerPtr->yCost * labs(y - dstPtr->y) +
+         routerPtr->zCost * labs(z - dstPtr->z);
+}
+
+
+/* =============================================================================
+ * expandToNeighborAStar
+ * -- Same relaxation as expandToNeighbor, but the neighbor is keyed by its
+ *    estimated total cost; ties are broken towards the cell closer to dst
+ * =============================================================================
+ */
+static void expandToNeighborAStar (router_t* routerPtr, grid_t* myGridPtr, point_t* movePtr, long x, long y, long z, long value, momentum_t fromArrival, unsigned char* arrivals, coordinate_t* dstPtr, long tieScale, heap_t* heapPtr, router_stats_t* statsPtr){
+  x += movePtr->x;
+  y += movePtr->y;
+  z += movePtr->z;
+  if (grid_isPointValid(myGridPtr, x, y, z)) {
+    long index = grid_getPointIndex(myGridPtr, x, y, z);
+    long neighborValue = grid_getCell(myGridPtr, index);
+    if (neighborValue == GRID_POINT_FULL) {
+      return;
+    }
+    if (neighborValue == value) {
+      recordArrival(arrivals, index, movePtr->momentum, fromArrival, FALSE);
+    } else if (neighborValue == GRID_POINT_EMPTY || value < neighborValue) {
+      long estimate = estimateCost(routerPtr, x, y, z, dstPtr);
+      grid_setCell(myGridPtr, index, value);
+      recordArrival(arrivals, index, movePtr->momentum, fromArrival, TRUE);
+      heap_insert(heapPtr, (value + estimate) * tieScale + estimate, INDEX_TO_DATA(index));
+      statsPtr->pushes++;
+    }
+  }
+}
+
+
+/* =============================================================================
+ * doExpansionAStar
+ * -- Leaves the same cost field as doExpansion along the cells it settles,
+ *    so doTraceback can be used unchanged; cells away from the goal
+ *    direction are simply never labelled
+ * =============================================================================
+ */
+static bool_t doExpansionAStar (router_t* routerPtr, grid_t* myGridPtr, heap_t* heapPtr, unsigned char* arrivals, coordinate_t* srcPtr, coordinate_t* dstPtr, router_stats_t* statsPtr){
+  long xCost = routerPtr->xCost;
+  long yCost = routerPtr->yCost;
+  long zCost = routerPtr->zCost;
+
+  /* every estimate is below tieScale, so (f * tieScale + h) orders by f first, then by h */
+  long tieScale = xCost * myGridPtr->width + yCost * myGridPtr->height + zCost * myGridPtr->depth + 1;
+
+  index_layout_t layout;
+  index_layout_init(&layout, myGridPtr);
+
+  heap_clear(heapPtr);
+  long srcIndex = grid_getPointIndex(myGridPtr, srcPtr->x, srcPtr->y, srcPtr->z);
+  long dstIndex = grid_getPointIndex(myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z);
+  long srcEstimate = estimateCost(routerPtr, srcPtr->x, srcPtr->y, srcPtr->z, dstPtr);
+  heap_insert(heapPtr, srcEstimate * tieScale + srcEstimate, INDEX_TO_DATA(srcIndex));
+  grid_setCell(myGridPtr, srcIndex, 0);
+  grid_setCell(myGridPtr, dstIndex, GRID_POINT_EMPTY);
+  if (arrivals) {
+    arrivals[srcIndex] = MOMENTUM_ZERO;
+  }
+  bool_t isPathFound = FALSE;
+
+  while (!heap_isEmpty(heapPtr)) {
+
+    long key;
+    long index = DATA_TO_INDEX(heap_remove(heapPtr, &key));
+    if (index == dstIndex) {
+      isPathFound = TRUE;
+      break;
+    }
+
+    long x;
+    long y;
+    long z;
+    index_layout_getPoint(&layout, (uint32_t)index, &x, &y, &z);
+    long value = grid_getCell(myGridPtr, index);
+
+    /* The cell was relaxed again after this entry was pushed: already expanded */
+    long estimate = estimateCost(routerPtr, x, y, z, dstPtr);
+    if (key != (value + estimate) * tieScale + estimate) {
+      continue;
+    }
+    statsPtr->expansions++;
+
+    momentum_t from = (arrivals ? (momentum_t)arrivals[index] : MOMENTUM_ZERO);
+    expandToNeighborAStar(routerPtr, myGridPtr, &MOVE_POSX, x, y, z, (value + xCost), from, arrivals, dstPtr, tieScale, heapPtr, statsPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, &MOVE_NEGX, x, y, z, (value + xCost), from, arrivals, dstPtr, tieScale, heapPtr, statsPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, &MOVE_POSY, x, y, z, (value + yCost), from, arrivals, dstPtr, tieScale, heapPtr, statsPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, &MOVE_NEGY, x, y, z, (value + yCost), from, arrivals, dstPtr, tieScale, heapPtr, statsPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, &MOVE_POSZ, x, y, z, (value + zCost), from, arrivals, dstPtr, tieScale, heapPtr, statsPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, &MOVE_NEGZ, x, y, z, (value + zCost), from, arrivals, dstPtr, tieScale, heapPtr, statsPtr);
+
+  } /* iterate over work heap */
+
+  return isPathFound;
+}
+
+
+/* =============================================================================
+ * traceToNeighbor
+ * =============================================================================
+ */
+static void traceToNeighbor (grid_t* myGridPtr, point_t* currPtr, point_t* movePtr, bool_t useMomentum, long bendCost, wave_t wave, point_t* nextPtr){
+  long x = currPtr->x + movePtr->x;
+  long y = currPtr->y + movePtr->y;
+  long z = currPtr->z + movePtr->z;
+
+  if (grid_isPointValid(myGridPtr, x, y, z)) {
+    long value = waveValue(grid_getCell(myGridPtr, grid_getPointIndex(myGridPtr, x, y, z)), wave);
+    if (value < 0) {
+      return;
+    }
+    long b = 0;
+    if (useMomentum && (currPtr->momentum != movePtr->momentum)) {
+      b = bendCost;
+    }
+    if ((value + b) <= nextPtr->value) { /* '=' favors neighbors over current */
+      nextPtr->x = x;
+      nextPtr->y = y;
+      nextPtr->z = z;
+      nextPtr->value = value;
+      nextPtr->momentum = movePtr->momentum;
+    }
+  }
+}
+
+
+/* =============================================================================
+ * traceWave
+ * -- Follows the labels of one wave from (x, y, z) back to the wave's origin,
+ *    appending the visited cells to pointVectorPtr
+ * -- Returns FALSE if the origin cannot be reached
+ * =============================================================================
+ */
+static bool_t traceWave (grid_t* gridPtr, grid_t* myGridPtr, long x, long y, long z, wave_t wave, long bendCost, vector_t* pointVectorPtr){
+  point_t next;
+  next.x = x;
+  next.y = y;
+  next.z = z;
+  next.value = waveValue(grid_getCell(myGridPtr, grid_getPointIndex(myGridPtr, next.x, next.y, next.z)), wave);
+  next.momentum = MOMENTUM_ZERO;
+
+  while (1) {
+
+    long* gridPointPtr = grid_getPointRef(gridPtr, next.x, next.y, next.z);
+    vector_pushBack(pointVectorPtr, (void*)gridPointPtr);
+    grid_setCell(myGridPtr, grid_getPointIndex(myGridPtr, next.x, next.y, next.z), GRID_POINT_FULL);
+
+    /* Check if we are done */
+    if (next.value == 0) {
+      break;
+    }
+    point_t curr = next;
+
+    /*
+     * Check 6 neighbors
+     *
+     * Potential Optimization: Only need to check 5 of these
+     */
+    traceToNeighbor(myGridPtr, &curr, &MOVE_POSX, TRUE, bendCost, wave, &next);
+    traceToNeighbor(myGridPtr, &curr, &MOVE_POSY, TRUE, bendCost, wave, &next);
+    traceToNeighbor(myGridPtr, &curr, &MOVE_POSZ, TRUE, bendCost, wave, &next);
+    traceToNeighbor(myGridPtr, &curr, &MOVE_NEGX, TRUE, bendCost, wave, &next);
+    traceToNeighbor(myGridPtr, &curr, &MOVE_NEGY, TRUE, bendCost, wave, &next);
+    traceToNeighbor(myGridPtr, &curr, &MOVE_NEGZ, TRUE, bendCost, wave, &next);
+
+    /*
+     * Because of bend costs, none of the neighbors may appear to be closer.
+     * In this case, pick a neighbor while ignoring momentum.
+     */
+    if ((curr.x == next.x) && (curr.y == next.y) && (curr.z == next.z)) {
+      next.value = curr.value;
+      traceToNeighbor(myGridPtr, &curr, &MOVE_POSX, FALSE, bendCost, wave, &next);
+      traceToNeighbor(myGridPtr, &curr, &MOVE_POSY, FALSE, bendCost, wave, &next);
+      traceToNeighbor(myGridPtr, &curr, &MOVE_POSZ, FALSE, bendCost, wave, &next);
+      traceToNeighbor(myGridPtr, &curr, &MOVE_NEGX, FALSE, bendCost, wave, &next);
+      traceToNeighbor(myGridPtr, &curr, &MOVE_NEGY, FALSE, bendCost, wave, &next);
+      traceToNeighbor(myGridPtr, &curr, &MOVE_NEGZ, FALSE, bendCost, wave, &next);
+
+      if ((curr.x == next.x) && (curr.y == next.y) && (curr.z == next.z)) {
+        return FALSE; /* cannot find path */
+      }
+    }
   }
 
-  return routerPtr;
+  return TRUE;
 }
 
 
 /* =============================================================================
- * router_free
+ * doTraceback
+ * -- The traceback functions fill the thread's point vector, so a net
+ *    costs no allocation until its path is kept
  * =============================================================================
  */
-void router_free (router_t* routerPtr){
-  free(routerPtr);
-}
-
+static vector_t* doTraceback (grid_t* gridPtr, grid_t* myGridPtr, coordinate_t* dstPtr, long bendCost, vector_t* pointVectorPtr){
+  vector_clear(pointVectorPtr);
 
-/* =============================================================================
- * expandToNeighbor
- * =============================================================================
- */
-static void expandToNeighbor (grid_t* myGridPtr, long x, long y, long z, long value, queue_t* queuePtr){
-  if (grid_isPointValid(myGridPtr, x, y, z)) {
-    long* neighborGridPointPtr = grid_getPointRef(myGridPtr, x, y, z);
-    long neighborValue = *neighborGridPointPtr;
-    if (neighborValue == GRID_POINT_EMPTY) {
-      (*neighborGridPointPtr) = value;
-      queue_push(queuePtr, (void*)neighborGridPointPtr);
-    } else if (neighborValue != GRID_POINT_FULL) {
-      /* We have expanded here before... is this new path better? */
-      if (value < neighborValue) {
-        (*neighborGridPointPtr) = value;
-        queue_push(queuePtr, (void*)neighborGridPointPtr);
-      }
-    }
+  if (!traceWave(gridPtr, myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z, WAVE_SRC, bendCost, pointVectorPtr)) {
+    return NULL;
   }
+
+  return pointVectorPtr;
 }
 
 
 /* =============================================================================
- * doExpansion
+ * doTracebackArrival
+ * -- Walks the recorded arrival moves back from dst to src: one read per
+ *    path cell, with no neighbor scans or label comparisons
  * =============================================================================
  */
-static bool_t doExpansion (router_t* routerPtr, grid_t* myGridPtr, queue_t* queuePtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
-  long xCost = routerPtr->xCost;
-  long yCost = routerPtr->yCost;
-  long zCost = routerPtr->zCost;
-
-  /*
-   * Potential Optimization: Make 'src' the one closest to edge.
-   * This will likely decrease the area of the emitted wave.
-   */
+static vector_t* doTracebackArrival (grid_t* gridPtr, grid_t* myGridPtr, unsigned char* arrivals, coordinate_t* srcPtr, coordinate_t* dstPtr, vector_t* pointVectorPtr){
+  vector_clear(pointVectorPtr);
 
-  queue_clear(queuePtr);
-  long* srcGridPointPtr = grid_getPointRef(myGridPtr, srcPtr->x, srcPtr->y, srcPtr->z);
-  queue_push(queuePtr, (void*)srcGridPointPtr);
-  grid_setPoint(myGridPtr, srcPtr->x, srcPtr->y, srcPtr->z, 0);
-  grid_setPoint(myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z, GRID_POINT_EMPTY);
-  long* dstGridPointPtr = grid_getPointRef(myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z);
-  bool_t isPathFound = FALSE;
+  index_layout_t layout;
+  index_layout_init(&layout, myGridPtr);
 
-  while (!queue_isEmpty(queuePtr)) {
+  long x = dstPtr->x;
+  long y = dstPtr->y;
+  long z = dstPtr->z;
+  long numStepLeft = myGridPtr->numCell; /* no simple path is longer */
 
-    long* gridPointPtr = (long*)queue_pop(queuePtr);
-    if (gridPointPtr == dstGridPointPtr) {
-      isPathFound = TRUE;
+  while (1) {
+    vector_pushBack(pointVectorPtr, (void*)grid_getPointRef(gridPtr, x, y, z));
+    if (x == srcPtr->x && y == srcPtr->y && z == srcPtr->z) {
       break;
     }
+    point_t* movePtr = MOVES[arrivals[index_layout_getIndex(&layout, x, y, z)]];
+    if (movePtr == NULL || --numStepLeft < 0) {
+      return NULL;
+    }
+    x -= movePtr->x;
+    y -= movePtr->y;
+    z -= movePtr->z;
+  }
 
-    long x;
-    long y;
-    long z;
-    grid_getPointIndices(myGridPtr, gridPointPtr, &x, &y, &z);
-    long value = (*gridPointPtr);
+  return pointVectorPtr;
+}
 
-    /*
-     * Check 6 neighbors
-     *
-     * Potential Optimization: Only need to check 5 of these
-     */
-    expandToNeighbor(myGridPtr, x+1, y,  z,  (value + xCost), queuePtr);
-    expandToNeighbor(myGridPtr, x-1, y,  z,  (value + xCost), queuePtr);
-    expandToNeighbor(myGridPtr, x,  y+1, z,  (value + yCost), queuePtr);
-    expandToNeighbor(myGridPtr, x,  y-1, z,  (value + yCost), queuePtr);
-    expandToNeighbor(myGridPtr, x,  y,  z+1, (value + zCost), queuePtr);
-    expandToNeighbor(myGridPtr, x,  y,  z-1, (value + zCost), queuePtr);
 
-  } /* iterate over work queue */
+/* =============================================================================
+ * doTracebackBidirectional
+ * -- Stitches the two halves met at the (srcSide, dstSide) edge into a
+ *    single dst -> src path, in the same order doTraceback produces
+ * =============================================================================
+ */
+static vector_t* doTracebackBidirectional (grid_t* gridPtr, grid_t* myGridPtr, coordinate_t* srcSidePtr, coordinate_t* dstSidePtr, long bendCost, vector_t* pointVectorPtr){
+  vector_clear(pointVectorPtr);
 
-  return isPathFound;
+  /* dstSide -> dst, reversed into dst -> dstSide */
+  if (!traceWave(gridPtr, myGridPtr, dstSidePtr->x, dstSidePtr->y, dstSidePtr->z, WAVE_DST, bendCost, pointVectorPtr)) {
+    return NULL;
+  }
+  long n = vector_getSize(pointVectorPtr);
+  long i;
+  void** elements = pointVectorPtr->elements;
+  for (i = 0; i < n / 2; i++) {
+    void* tmp = elements[i];
+    elements[i] = elements[n - 1 - i];
+    elements[n - 1 - i] = tmp;
+  }
+
+  /* srcSide -> src */
+  if (!traceWave(gridPtr, myGridPtr, srcSidePtr->x, srcSidePtr->y, srcSidePtr->z, WAVE_SRC, bendCost, pointVectorPtr)) {
+    return NULL;
+  }
+
+  return pointVectorPtr;
 }
 
 
 /* =============================================================================
- * traceToNeighbor
+ * traceToNeighborBitset
+ * -- traceToNeighbor over the layers of a bitset wave: a neighbor of a point
+ *    of layer l is labelled l - 1 or l (or l + 1, which is never picked)
  * =============================================================================
  */
-static void traceToNeighbor (grid_t* myGridPtr, point_t* currPtr, point_t* movePtr, bool_t useMomentum, long bendCost, point_t* nextPtr){
+static void traceToNeighborBitset (grid_t* myGridPtr, bitset_log_t* logPtr, long stride, long cost, point_t* currPtr, point_t* movePtr, bool_t useMomentum, long bendCost, point_t* nextPtr){
   long x = currPtr->x + movePtr->x;
   long y = currPtr->y + movePtr->y;
   long z = currPtr->z + movePtr->z;
 
-  if (grid_isPointValid(myGridPtr, x, y, z) &&
-    !grid_isPointEmpty(myGridPtr, x, y, z) &&
-    !grid_isPointFull(myGridPtr, x, y, z))
-  {
-    long value = grid_getPoint(myGridPtr, x, y, z);
+  if (grid_isPointValid(myGridPtr, x, y, z)) {
+    long key = (z * myGridPtr->height + y) * stride + 1 + x / GRID_OCCUPANCY_WORD_BITS;
+    uint64_t bit = (uint64_t)1 << (x % GRID_OCCUPANCY_WORD_BITS);
+    long layer = currPtr->value / cost;
+    uint64_t* bitsPtr = bitsetLog_find(logPtr, (layer - 1), key);
+    if (bitsPtr && (*bitsPtr & bit)) {
+      layer--;
+    } else {
+      bitsPtr = bitsetLog_find(logPtr, layer, key);
+      if (!bitsPtr || !(*bitsPtr & bit)) {
+        return;
+      }
+    }
+    long value = layer * cost;
     long b = 0;
     if (useMomentum && (currPtr->momentum != movePtr->momentum)) {
       b = bendCost;
@@ -222,59 +1912,52 @@ static void traceToNeighbor (grid_t* myGridPtr, point_t* currPtr, point_t* moveP
 
 
 /* =============================================================================
- * doTraceback
+ * doTracebackBitset
+ * -- doTraceback for doExpansionBitset: labels are the layers of the log
+ *    times the (common) move cost, so the same path is picked; the points
+ *    taken are cleared from the log rather than marked full on the grid
  * =============================================================================
  */
-static vector_t* doTraceback (grid_t* gridPtr, grid_t* myGridPtr, coordinate_t* dstPtr, long bendCost){
-  vector_t* pointVectorPtr = vector_alloc(1);
-  assert(pointVectorPtr);
+static vector_t* doTracebackBitset (router_t* routerPtr, grid_t* gridPtr, grid_t* myGridPtr, bitset_log_t* logPtr, coordinate_t* dstPtr, vector_t* pointVectorPtr){
+  long stride = gridPtr->occupancyRowWords + 2;
+  long cost = routerPtr->xCost;
+  long bendCost = routerPtr->bendCost;
+  point_t* moves[] = {&MOVE_POSX, &MOVE_POSY, &MOVE_POSZ, &MOVE_NEGX, &MOVE_NEGY, &MOVE_NEGZ};
+  long m;
+
+  vector_clear(pointVectorPtr);
 
   point_t next;
   next.x = dstPtr->x;
   next.y = dstPtr->y;
   next.z = dstPtr->z;
-  next.value = grid_getPoint(myGridPtr, next.x, next.y, next.z);
+  next.value = (logPtr->numLayer - 1) * cost;
   next.momentum = MOMENTUM_ZERO;
 
   while (1) {
 
-    long* gridPointPtr = grid_getPointRef(gridPtr, next.x, next.y, next.z);
-    vector_pushBack(pointVectorPtr, (void*)gridPointPtr);
-    grid_setPoint(myGridPtr, next.x, next.y, next.z, GRID_POINT_FULL);
+    vector_pushBack(pointVectorPtr, (void*)grid_getPointRef(gridPtr, next.x, next.y, next.z));
+    long key = (next.z * myGridPtr->height + next.y) * stride + 1 + next.x / GRID_OCCUPANCY_WORD_BITS;
+    uint64_t* bitsPtr = bitsetLog_find(logPtr, (next.value / cost), key);
+    assert(bitsPtr);
+    *bitsPtr &= ~((uint64_t)1 << (next.x % GRID_OCCUPANCY_WORD_BITS));
 
-    /* Check if we are done */
     if (next.value == 0) {
       break;
     }
     point_t curr = next;
 
-    /*
-     * Check 6 neighbors
-     *
-     * Potential Optimization: Only need to check 5 of these
-     */
-    traceToNeighbor(myGridPtr, &curr, &MOVE_POSX, TRUE, bendCost, &next);
-    traceToNeighbor(myGridPtr, &curr, &MOVE_POSY, TRUE, bendCost, &next);
-    traceToNeighbor(myGridPtr, &curr, &MOVE_POSZ, TRUE, bendCost, &next);
-    traceToNeighbor(myGridPtr, &curr, &MOVE_NEGX, TRUE, bendCost, &next);
-    traceToNeighbor(myGridPtr, &curr, &MOVE_NEGY, TRUE, bendCost, &next);
-    traceToNeighbor(myGridPtr, &curr, &MOVE_NEGZ, TRUE, bendCost, &next);
+    for (m = 0; m < 6; m++) {
+      traceToNeighborBitset(myGridPtr, logPtr, stride, cost, &curr, moves[m], TRUE, bendCost, &next);
+    }
 
-    /*
-     * Because of bend costs, none of the neighbors may appear to be closer.
-     * In this case, pick a neighbor while ignoring momentum.
-     */
+    /* as in traceWave: failing that, ignore momentum */
     if ((curr.x == next.x) && (curr.y == next.y) && (curr.z == next.z)) {
       next.value = curr.value;
-      traceToNeighbor(myGridPtr, &curr, &MOVE_POSX, FALSE, bendCost, &next);
-      traceToNeighbor(myGridPtr, &curr, &MOVE_POSY, FALSE, bendCost, &next);
-      traceToNeighbor(myGridPtr, &curr, &MOVE_POSZ, FALSE, bendCost, &next);
-      traceToNeighbor(myGridPtr, &curr, &MOVE_NEGX, FALSE, bendCost, &next);
-      traceToNeighbor(myGridPtr, &curr, &MOVE_NEGY, FALSE, bendCost, &next);
-      traceToNeighbor(myGridPtr, &curr, &MOVE_NEGZ, FALSE, bendCost, &next);
-
+      for (m = 0; m < 6; m++) {
+        traceToNeighborBitset(myGridPtr, logPtr, stride, cost, &curr, moves[m], FALSE, bendCost, &next);
+      }
       if ((curr.x == next.x) && (curr.y == next.y) && (curr.z == next.z)) {
-        vector_free(pointVectorPtr);
         return NULL; /* cannot find path */
       }
     }
@@ -284,6 +1967,518 @@ static vector_t* doTraceback (grid_t* gridPtr, grid_t* myGridPtr, coordinate_t*
 }
 
 
+/* =============================================================================
+ * workspace_alloc
+ * -- Per-thread structures needed by the selected expansion engine
+ * =============================================================================
+ */
+static router_workspace_t* workspace_alloc (router_t* routerPtr, grid_t* gridPtr){
+  router_workspace_t* workspacePtr = (router_workspace_t*)malloc(sizeof(router_workspace_t));
+  assert(workspacePtr);
+
+  workspacePtr->indexqueuePtr = NULL;
+  workspacePtr->queuePtr = NULL;
+  workspacePtr->dstQueuePtr = NULL;
+  workspacePtr->heapPtr = NULL;
+  workspacePtr->bucketqueuePtr = NULL;
+  workspacePtr->bitsPtr = NULL;
+  memset(&workspacePtr->bitsetLog, 0, sizeof(bitset_log_t));
+  workspacePtr->sweepDistPtr = NULL;
+  workspacePtr->sweepWallPtr = NULL;
+  workspacePtr->relaxRow = NULL;
+  workspacePtr->arrivals = NULL;
+  workspacePtr->deltaPtr = NULL;
+  workspacePtr->crewPtr = NULL;
+  workspacePtr->isTail = FALSE;
+  workspacePtr->isSharedRead = FALSE;
+  workspacePtr->pointVectorPtr = vector_alloc(1);
+  assert(workspacePtr->pointVectorPtr);
+  workspacePtr->detourVectorPtr = NULL;
+  workspacePtr->spliceVectorPtr = NULL;
+  workspacePtr->claimPtr = grid_claim_alloc();
+  assert(workspacePtr->claimPtr);
+  memset(&workspacePtr->stats, 0, sizeof(router_stats_t));
+
+  switch (routerPtr->expansion) {
+    case ROUTER_EXPANSION_ASTAR:
+      workspacePtr->heapPtr = heap_alloc(1024);
+      assert(workspacePtr->heapPtr);
+      break;
+    case ROUTER_EXPANSION_BIDIR:
+      workspacePtr->queuePtr = queue_alloc(-1);
+      workspacePtr->dstQueuePtr = queue_alloc(-1);
+      assert(workspacePtr->queuePtr && workspacePtr->dstQueuePtr);
+      break;
+    case ROUTER_EXPANSION_DIAL:
+      assert(routerPtr->xCost >= 0 && routerPtr->yCost >= 0 && routerPtr->zCost >= 0);
+      workspacePtr->bucketqueuePtr = bucketqueue_alloc(MAX(routerPtr->xCost, MAX(routerPtr->yCost, routerPtr->zCost)));
+      assert(workspacePtr->bucketqueuePtr);
+      break;
+    case ROUTER_EXPANSION_BITSET: {
+      /* three planes of padded rows, one padded row of zeros, then the
+       * frontier and next layer row flags */
+      long numRow = gridPtr->height * gridPtr->depth;
+      long numWord = (3 * numRow + 1) * (gridPtr->occupancyRowWords + 2);
+      workspacePtr->bitsPtr = (uint64_t*)calloc((numWord + (2 * numRow + 7) / 8), sizeof(uint64_t));
+      assert(workspacePtr->bitsPtr);
+      break;
+    }
+    case ROUTER_EXPANSION_SWEEP: {
+      long n = gridPtr->width * gridPtr->height * gridPtr->depth;
+      /* costs are summed in 32 bits, below RELAX_INFINITY */
+      assert(routerPtr->xCost >= 0 && routerPtr->yCost >= 0 && routerPtr->zCost >= 0);
+      assert((routerPtr->xCost + routerPtr->yCost + routerPtr->zCost) * n < RELAX_INFINITY);
+      workspacePtr->sweepDistPtr = (int32_t*)malloc(n * sizeof(int32_t));
+      workspacePtr->sweepWallPtr = (int32_t*)malloc(n * sizeof(int32_t));
+      assert(workspacePtr->sweepDistPtr && workspacePtr->sweepWallPtr);
+      workspacePtr->relaxRow = relax_selectRow();
+      break;
+    }
+    case ROUTER_EXPANSION_DELTA:
+      workspacePtr->deltaPtr = delta_alloc(routerPtr, gridPtr);
+      break;
+    case ROUTER_EXPANSION_LEE:
+    default:
+      /* grid indices must fit the 32-bit queue entries */
+      assert(gridPtr->numCell <= ((long)UINT32_MAX + 1));
+      workspacePtr->indexqueuePtr = indexqueue_alloc(gridPtr->numCell);
+      assert(workspacePtr->indexqueuePtr);
+      break;
+  }
+
+  if (routerPtr->traceback == ROUTER_TRACEBACK_ARRIVAL &&
+      (routerPtr->expansion == ROUTER_EXPANSION_LEE ||
+       routerPtr->expansion == ROUTER_EXPANSION_ASTAR ||
+       routerPtr->expansion == ROUTER_EXPANSION_DIAL))
+  {
+    /* only read along paths labelled for the current net: never cleared */
+    workspacePtr->arrivals = (unsigned char*)malloc(gridPtr->numCell * sizeof(unsigned char));
+    assert(workspacePtr->arrivals);
+  }
+
+  if (routerPtr->repairMargin >= 0) {
+    /* detours are found by a lee wave, whatever the engine */
+    if (workspacePtr->indexqueuePtr == NULL) {
+      assert(gridPtr->numCell <= ((long)UINT32_MAX + 1));
+      workspacePtr->indexqueuePtr = indexqueue_alloc(gridPtr->numCell);
+      assert(workspacePtr->indexqueuePtr);
+    }
+    workspacePtr->detourVectorPtr = vector_alloc(1);
+    workspacePtr->spliceVectorPtr = vector_alloc(1);
+    assert(workspacePtr->detourVectorPtr && workspacePtr->spliceVectorPtr);
+  }
+
+  return workspacePtr;
+}
+
+
+/* =============================================================================
+ * workspace_free
+ * =============================================================================
+ */
+static void workspace_free (router_workspace_t* workspacePtr){
+  if (workspacePtr->indexqueuePtr) {
+    indexqueue_free(workspacePtr->indexqueuePtr);
+  }
+  if (workspacePtr->queuePtr) {
+    queue_free(workspacePtr->queuePtr);
+  }
+  if (workspacePtr->dstQueuePtr) {
+    queue_free(workspacePtr->dstQueuePtr);
+  }
+  if (workspacePtr->heapPtr) {
+    heap_free(workspacePtr->heapPtr);
+  }
+  if (workspacePtr->bucketqueuePtr) {
+    bucketqueue_free(workspacePtr->bucketqueuePtr);
+  }
+  free(workspacePtr->bitsPtr);
+  free(workspacePtr->bitsetLog.keys);
+  free(workspacePtr->bitsetLog.bits);
+  free(workspacePtr->bitsetLog.layerStarts);
+  free(workspacePtr->sweepDistPtr);
+  free(workspacePtr->sweepWallPtr);
+  free(workspacePtr->arrivals);
+  if (workspacePtr->deltaPtr) {
+    delta_free(workspacePtr->deltaPtr);
+  }
+  vector_free(workspacePtr->pointVectorPtr);
+  grid_claim_free(workspacePtr->claimPtr);
+  if (workspacePtr->detourVectorPtr) {
+    vector_free(workspacePtr->detourVectorPtr);
+  }
+  if (workspacePtr->spliceVectorPtr) {
+    vector_free(workspacePtr->spliceVectorPtr);
+  }
+  free(workspacePtr);
+}
+
+
+/* =============================================================================
+ * isLongNet
+ * -- TRUE if the net is worth a delta team: its src and dst are at least
+ *    the router's threshold apart (in moves)
+ * =============================================================================
+ */
+static bool_t isLongNet (router_t* routerPtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
+  long length = labs(srcPtr->x - dstPtr->x) + labs(srcPtr->y - dstPtr->y) + labs(srcPtr->z - dstPtr->z);
+  return ((routerPtr->deltaThreshold >= 0 && length >= routerPtr->deltaThreshold) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * findPath
+ * -- Runs the expansion engine selected in the router and its traceback
+ * -- Returns the workspace's point vector, or NULL if no path was found
+ * =============================================================================
+ */
+static vector_t* findPath (router_t* routerPtr, grid_t* gridPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
+  long bendCost = routerPtr->bendCost;
+  router_stats_t* statsPtr = &workspacePtr->stats;
+  unsigned char* arrivals = workspacePtr->arrivals;
+  vector_t* pointVectorPtr = workspacePtr->pointVectorPtr;
+  workspacePtr->isSharedRead = FALSE;
+
+  /*
+   * Long nets, and in the tail of the work queue every net, are expanded by
+   * a team of the threads left without nets, if any is there to join it
+   */
+  if (routerPtr->expansion == ROUTER_EXPANSION_DELTA ||
+      ((workspacePtr->isTail || isLongNet(routerPtr, srcPtr, dstPtr)) && crew_hasIdle(workspacePtr->crewPtr)))
+  {
+    if (workspacePtr->deltaPtr == NULL) {
+      workspacePtr->deltaPtr = delta_alloc(routerPtr, gridPtr);
+    }
+    router_delta_t* deltaPtr = workspacePtr->deltaPtr;
+    delta_setup(deltaPtr, workspacePtr->crewPtr, gridPtr, myGridPtr, srcPtr, dstPtr);
+    long numHelper = crew_recruit(workspacePtr->crewPtr, deltaPtr, FALSE);
+    if (numHelper > 0 || routerPtr->expansion == ROUTER_EXPANSION_DELTA) {
+      bool_t isPathFound = delta_expand(deltaPtr, TRUE, FALSE, statsPtr);
+      crew_dismiss(deltaPtr);
+      workspacePtr->isSharedRead = TRUE;
+      if (!isPathFound) {
+        return NULL;
+      }
+      return doTraceback(gridPtr, myGridPtr, dstPtr, bendCost, pointVectorPtr);
+    }
+  }
+
+  switch (routerPtr->expansion) {
+    case ROUTER_EXPANSION_ASTAR:
+      if (!doExpansionAStar(routerPtr, myGridPtr, workspacePtr->heapPtr, arrivals, srcPtr, dstPtr, statsPtr)) {
+        return NULL;
+      }
+      if (arrivals) {
+        return doTracebackArrival(gridPtr, myGridPtr, arrivals, srcPtr, dstPtr, pointVectorPtr);
+      }
+      return doTraceback(gridPtr, myGridPtr, dstPtr, bendCost, pointVectorPtr);
+    case ROUTER_EXPANSION_BIDIR: {
+      coordinate_t srcSide;
+      coordinate_t dstSide;
+      if (!doExpansionBidirectional(routerPtr, myGridPtr, workspacePtr->queuePtr, workspacePtr->dstQueuePtr,
+                                    srcPtr, dstPtr, &srcSide, &dstSide, statsPtr)) {
+        return NULL;
+      }
+      return doTracebackBidirectional(gridPtr, myGridPtr, &srcSide, &dstSide, bendCost, pointVectorPtr);
+    }
+    case ROUTER_EXPANSION_DIAL:
+      if (!doExpansionOrdered(routerPtr, myGridPtr, workspacePtr->bucketqueuePtr, arrivals, srcPtr, dstPtr, statsPtr)) {
+        return NULL;
+      }
+      if (arrivals) {
+        return doTracebackArrival(gridPtr, myGridPtr, arrivals, srcPtr, dstPtr, pointVectorPtr);
+      }
+      return doTraceback(gridPtr, myGridPtr, dstPtr, bendCost, pointVectorPtr);
+    case ROUTER_EXPANSION_BITSET:
+      workspacePtr->isSharedRead = TRUE;
+      if (!doExpansionBitset(gridPtr, myGridPtr, workspacePtr, srcPtr, dstPtr, statsPtr)) {
+        return NULL;
+      }
+      return doTracebackBitset(routerPtr, gridPtr, myGridPtr, &workspacePtr->bitsetLog, dstPtr, pointVectorPtr);
+    case ROUTER_EXPANSION_SWEEP:
+      if (!doExpansionSweep(routerPtr, myGridPtr, workspacePtr, srcPtr, dstPtr, statsPtr)) {
+        return NULL;
+      }
+      return doTraceback(gridPtr, myGridPtr, dstPtr, bendCost, pointVectorPtr);
+    case ROUTER_EXPANSION_LEE:
+    default:
+      if (!doExpansion(routerPtr, myGridPtr, workspacePtr->indexqueuePtr, arrivals, srcPtr, dstPtr, statsPtr)) {
+        return NULL;
+      }
+      if (arrivals) {
+        return doTracebackArrival(gridPtr, myGridPtr, arrivals, srcPtr, dstPtr, pointVectorPtr);
+      }
+      return doTraceback(gridPtr, myGridPtr, dstPtr, bendCost, pointVectorPtr);
+  }
+}
+
+
+/* =============================================================================
+ * router_selectCellType
+ * -- Narrowest cell type the router allows that holds every label an engine
+ *    can write: labels are costs of simple paths, or DST_WAVE_BASE minus
+ *    one for the dst wave, so they stay within +-((n - 1) * maxCost + 3)
+ * =============================================================================
+ */
+grid_cell_t router_selectCellType (router_t* routerPtr, grid_t* gridPtr){
+  long n = gridPtr->width * gridPtr->height * gridPtr->depth;
+  long maxCost = MAX(1, MAX(routerPtr->xCost, MAX(routerPtr->yCost, routerPtr->zCost)));
+  long maxLabel = (n - 1) * maxCost - DST_WAVE_BASE;
+
+  if (routerPtr->cellBits <= 16 && maxLabel <= grid_getCellMax(GRID_CELL_INT16)) {
+    return GRID_CELL_INT16;
+  }
+  if (routerPtr->cellBits <= 32 && maxLabel <= grid_getCellMax(GRID_CELL_INT32)) {
+    return GRID_CELL_INT32;
+  }
+  return GRID_CELL_LONG;
+}
+
+
+/* =============================================================================
+ * refreshGrid
+ * -- Brings the private grid (or its window) up to date with the shared one
+ * =============================================================================
+ */
+static void refreshGrid (router_t* routerPtr, grid_t* gridPtr, grid_t* myGridPtr, bool_t isWindowed){
+  if (routerPtr->scratch == ROUTER_SCRATCH_EPOCH) {
+    grid_resetScratch(myGridPtr);
+  } else if (isWindowed) {
+    grid_copyWindow(myGridPtr, gridPtr);
+  } else {
+    grid_copy(myGridPtr, gridPtr);
+  }
+}
+
+
+/* =============================================================================
+ * findPathWindowed
+ * -- Copies and expands only the src/dst bounding box plus the router's
+ *    margin, widening the window geometrically while no path is found
+ *    inside it; with a negative margin the whole grid is used at once
+ * =============================================================================
+ */
+static vector_t* findPathWindowed (router_t* routerPtr, grid_t* gridPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
+  long margin = routerPtr->windowMargin;
+  /* the bitset engine reads the shared occupancy bits, unless delta teams may take the net */
+  bool_t isRefreshed = (routerPtr->expansion != ROUTER_EXPANSION_BITSET || workspacePtr->crewPtr != NULL);
+  if (margin < 0) {
+    if (isRefreshed) {
+      refreshGrid(routerPtr, gridPtr, myGridPtr, FALSE);
+    }
+    return findPath(routerPtr, gridPtr, myGridPtr, workspacePtr, srcPtr, dstPtr);
+  }
+
+  while (1) {
+    bool_t isWholeGrid = grid_setWindow(myGridPtr,
+                                        MIN(srcPtr->x, dstPtr->x) - margin,
+                                        MIN(srcPtr->y, dstPtr->y) - margin,
+                                        MIN(srcPtr->z, dstPtr->z) - margin,
+                                        MAX(srcPtr->x, dstPtr->x) + margin,
+                                        MAX(srcPtr->y, dstPtr->y) + margin,
+                                        MAX(srcPtr->z, dstPtr->z) + margin);
+    if (isRefreshed) {
+      refreshGrid(routerPtr, gridPtr, myGridPtr, TRUE);
+    }
+    vector_t* pointVectorPtr = findPath(routerPtr, gridPtr, myGridPtr, workspacePtr, srcPtr, dstPtr);
+    if (pointVectorPtr || isWholeGrid) {
+      return pointVectorPtr;
+    }
+    margin = ((margin > 0) ? (margin * WINDOW_GROWTH_FACTOR) : 1);
+  }
+}
+
+
+/* =============================================================================
+ * repairPath
+ * -- The commit of the path found FULL points other nets took meanwhile:
+ *    the stretch from the first to the last of them is routed again by a
+ *    lee wave between the path points just outside it, inside their
+ *    bounding box plus the router's repair margin, with the rest of the
+ *    path kept (and walled off, so the detour cannot cross it)
+ * -- Returns the path with the detour spliced in (the workspace's point
+ *    vector again), or NULL if none was found in the window
+ * =============================================================================
+ */
+static vector_t* repairPath (router_t* routerPtr, grid_t* gridPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, vector_t* pathVectorPtr){
+  assert(pathVectorPtr == workspacePtr->pointVectorPtr);
+  long n = vector_getSize(pathVectorPtr);
+  long first = -1;
+  long last = -1;
+  long i;
+
+  /* the ends belong to the net: only the points between can be taken */
+  for (i = 1; i < (n-1); i++) {
+    if (*(long*)vector_at(pathVectorPtr, i) == GRID_POINT_FULL) {
+      if (first < 0) {
+        first = i;
+      }
+      last = i;
+    }
+  }
+  if (first < 0) {
+    return NULL;
+  }
+  long from = first - 1;
+  long to = last + 1;
+
+  coordinate_t lo;
+  coordinate_t hi;
+  grid_getPointIndices(gridPtr, (long*)vector_at(pathVectorPtr, from), &lo.x, &lo.y, &lo.z);
+  hi = lo;
+  for (i = from + 1; i <= to; i++) {
+    coordinate_t point;
+    grid_getPointIndices(gridPtr, (long*)vector_at(pathVectorPtr, i), &point.x, &point.y, &point.z);
+    lo.x = MIN(lo.x, point.x);
+    lo.y = MIN(lo.y, point.y);
+    lo.z = MIN(lo.z, point.z);
+    hi.x = MAX(hi.x, point.x);
+    hi.y = MAX(hi.y, point.y);
+    hi.z = MAX(hi.z, point.z);
+  }
+
+  /* the private grid is only borrowed: its window is put back after */
+  long xMin = myGridPtr->xMin;
+  long yMin = myGridPtr->yMin;
+  long zMin = myGridPtr->zMin;
+  long xMax = myGridPtr->xMax;
+  long yMax = myGridPtr->yMax;
+  long zMax = myGridPtr->zMax;
+  long margin = routerPtr->repairMargin;
+  grid_setWindow(myGridPtr, (lo.x - margin), (lo.y - margin), (lo.z - margin),
+                 (hi.x + margin), (hi.y + margin), (hi.z + margin));
+  refreshGrid(routerPtr, gridPtr, myGridPtr, TRUE);
+  for (i = 0; i < n; i++) {
+    if (i == from) {
+      i = to;
+      continue;
+    }
+    coordinate_t point;
+    grid_getPointIndices(gridPtr, (long*)vector_at(pathVectorPtr, i), &point.x, &point.y, &point.z);
+    if (grid_isPointValid(myGridPtr, point.x, point.y, point.z)) {
+      grid_setCell(myGridPtr, grid_getPointIndex(myGridPtr, point.x, point.y, point.z), GRID_POINT_FULL);
+    }
+  }
+
+  /* paths run dst -> src, so the detour runs from -> to like the stretch it replaces */
+  coordinate_t src;
+  coordinate_t dst;
+  grid_getPointIndices(gridPtr, (long*)vector_at(pathVectorPtr, to), &src.x, &src.y, &src.z);
+  grid_getPointIndices(gridPtr, (long*)vector_at(pathVectorPtr, from), &dst.x, &dst.y, &dst.z);
+  vector_t* detourVectorPtr = NULL;
+  if (doExpansion(routerPtr, myGridPtr, workspacePtr->indexqueuePtr, NULL, &src, &dst, &workspacePtr->stats)) {
+    detourVectorPtr = doTraceback(gridPtr, myGridPtr, &dst, routerPtr->bendCost, workspacePtr->detourVectorPtr);
+  }
+  grid_setWindow(myGridPtr, xMin, yMin, zMin, xMax, yMax, zMax);
+  if (detourVectorPtr == NULL) {
+    return NULL;
+  }
+
+  vector_t* spliceVectorPtr = workspacePtr->spliceVectorPtr;
+  vector_clear(spliceVectorPtr);
+  for (i = 0; i < from; i++) {
+    vector_pushBack(spliceVectorPtr, vector_at(pathVectorPtr, i));
+  }
+  long numDetour = vector_getSize(detourVectorPtr);
+  for (i = 0; i < numDetour; i++) {
+    vector_pushBack(spliceVectorPtr, vector_at(detourVectorPtr, i));
+  }
+  for (i = to + 1; i < n; i++) {
+    vector_pushBack(spliceVectorPtr, vector_at(pathVectorPtr, i));
+  }
+  workspacePtr->spliceVectorPtr = pathVectorPtr;
+  workspacePtr->pointVectorPtr = spliceVectorPtr;
+
+  return spliceVectorPtr;
+}
+
+
+/* =============================================================================
+ * commitBatch
+ * -- Serial: commits the paths of the batch in net order; nets whose path
+ *    an earlier one took are kept to be routed (or, with a repair margin,
+ *    repaired) again, unroutable ones are dropped
+ * =============================================================================
+ */
+static void commitBatch (grid_t* gridPtr, batch_t* batchPtr, contention_t* contentionPtr, router_workspace_t* workspacePtr){
+  router_stats_t* statsPtr = &workspacePtr->stats;
+  long i;
+  for (i = 0; i < batchPtr->numSlot; i++) {
+    batch_slot_t* slotPtr = &batchPtr->slots[i];
+    /* a path path_alloc rejects is dropped like an unroutable net */
+    path_t* pathPtr = (slotPtr->isRouted ? path_alloc(gridPtr, slotPtr->pointVectorPtr) : NULL);
+    if (pathPtr == NULL) {
+      pair_free(slotPtr->coordinatePairPtr);
+      continue;
+    }
+    if (grid_checkPath_Ptr(gridPtr, NULL, contentionPtr, workspacePtr->claimPtr, slotPtr->pointVectorPtr)) {
+      grid_addPath_Ptr(gridPtr, workspacePtr->claimPtr, slotPtr->pointVectorPtr);
+      if (slotPtr->isRepaired) {
+        statsPtr->repairs++;
+      }
+      bool_t status = vector_pushBack(batchPtr->pathVectorPtr, (void*)pathPtr);
+      assert(status);
+      pair_free(slotPtr->coordinatePairPtr);
+    } else {
+      path_free(pathPtr);
+      statsPtr->retries++;
+      batch_requeue(batchPtr, i);
+    }
+  }
+}
+
+
+/* =============================================================================
+ * routeBatches
+ * -- ROUTER_SCHEDULE_BATCH (batch.h): every thread runs it until the work
+ *    queue is done; between two barriers, the thread elected commits the
+ *    last batch and takes the next, then all of them route its nets
+ * =============================================================================
+ */
+static void routeBatches (router_t* routerPtr, grid_t* gridPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, contention_t* contentionPtr, batch_t* batchPtr, queue_t* workQueuePtr){
+  while (1) {
+    if (batch_wait(batchPtr)) {
+      TIMER_T startTime;
+      TIMER_READ(startTime);
+      commitBatch(gridPtr, batchPtr, contentionPtr, workspacePtr);
+      batch_fill(batchPtr, workQueuePtr);
+      TIMER_T stopTime;
+      TIMER_READ(stopTime);
+      batchPtr->serialSeconds += TIMER_DIFF_SECONDS(startTime, stopTime);
+    }
+    batch_wait(batchPtr);
+    if (batchPtr->numSlot == 0) {
+      break;
+    }
+
+    /* the shared grid stays as it is until every net of the batch is routed */
+    long i;
+    while ((i = batch_claim(batchPtr)) >= 0) {
+      batch_slot_t* slotPtr = &batchPtr->slots[i];
+      coordinate_t* srcPtr = slotPtr->coordinatePairPtr->firstPtr;
+      coordinate_t* dstPtr = slotPtr->coordinatePairPtr->secondPtr;
+      contention_beginNet(contentionPtr);
+      vector_t* pointVectorPtr = NULL;
+      if (slotPtr->isLost && routerPtr->repairMargin >= 0) {
+        /* the batch's grid is the one its path lost to: mend it, as a commit would */
+        bool_t status = vector_copy(workspacePtr->pointVectorPtr, slotPtr->pointVectorPtr);
+        assert(status);
+        pointVectorPtr = repairPath(routerPtr, gridPtr, myGridPtr, workspacePtr, workspacePtr->pointVectorPtr);
+        slotPtr->isRepaired = (pointVectorPtr != NULL);
+      }
+      if (pointVectorPtr == NULL) {
+        pointVectorPtr = findPathWindowed(routerPtr, gridPtr, myGridPtr, workspacePtr, srcPtr, dstPtr);
+      }
+      if (pointVectorPtr) {
+        bool_t status = vector_copy(slotPtr->pointVectorPtr, pointVectorPtr);
+        assert(status);
+        slotPtr->isRouted = TRUE;
+      }
+    }
+  }
+}
+
+
 /* =============================================================================
  * router_solve
  * =============================================================================
@@ -298,33 +2493,55 @@ void *router_solve (void* argPtr){
   queue_t* workQueuePtr = mazePtr->workQueuePtr;
   pthread_mutex_t* work_queue_mutex = routerArgPtr->workQueueMutex;
   pthread_mutex_t* list_mutex = routerArgPtr->listMutex;
+  partition_t* partitionPtr = routerArgPtr->partitionPtr;
+  steal_t* stealPtr = routerArgPtr->stealPtr;
+  long myDeque = (stealPtr ? steal_join(stealPtr) : -1);
+  batch_t* batchPtr = routerArgPtr->batchPtr;
 
   grid_t* gridPtr = mazePtr->gridPtr;
-  grid_t* myGridPtr = grid_alloc(gridPtr->width, gridPtr->height, gridPtr->depth);
+  grid_t* myGridPtr = grid_allocPrivate(gridPtr, router_selectCellType(routerPtr, gridPtr),
+                                        (routerPtr->scratch == ROUTER_SCRATCH_EPOCH));
   assert(myGridPtr);
-  long bendCost = routerPtr->bendCost;
-  queue_t* myExpansionQueuePtr = queue_alloc(-1);
+  router_workspace_t* myWorkspacePtr = workspace_alloc(routerPtr, gridPtr);
+  myWorkspacePtr->crewPtr = routerArgPtr->crewPtr;
+  contention_t* myContentionPtr = contention_alloc(routerArgPtr->contentionManagerPtr, (unsigned long)random());
+  assert(myContentionPtr);
+
+  if (batchPtr) {
+    routeBatches(routerPtr, gridPtr, myGridPtr, myWorkspacePtr, myContentionPtr, batchPtr, workQueuePtr);
+  }
 
   /*
    * Iterate over work list to route each path. This involves an
    * 'expansion' and 'traceback' phase for each source/destination pair.
+   * Batches leave the work list empty
    */
-  while (1) {
+  while (batchPtr == NULL) {
 
     pair_t* coordinatePairPtr;
     
-    Pthread_mutex_lock(abort_exec, "router_solve: failed to lock work queue", work_queue_mutex);
-    bool_t empty= queue_isEmpty(workQueuePtr);
-    if (empty) {
-      coordinatePairPtr = NULL;
+    if (stealPtr) {
+      coordinatePairPtr = steal_take(stealPtr, myDeque, &myWorkspacePtr->stats.steals);
     } else {
-      coordinatePairPtr = queue_pop(workQueuePtr);
+      Pthread_mutex_lock(abort_exec, "router_solve: failed to lock work queue", work_queue_mutex);
+      bool_t empty= queue_isEmpty(workQueuePtr);
+      if (partitionPtr) {
+        coordinatePairPtr = partition_take(partitionPtr, workQueuePtr);
+      } else if (empty) {
+        coordinatePairPtr = NULL;
+      } else {
+        coordinatePairPtr = queue_pop(workQueuePtr);
+        /* some thread is bound to run out of nets while this one is routed */
+        myWorkspacePtr->isTail = (routerPtr->schedule == ROUTER_SCHEDULE_HYBRID &&
+                                  crew_isTail(routerArgPtr->crewPtr, queue_getSize(workQueuePtr)));
+      }
+      Pthread_mutex_unlock(abort_exec, "router_solve: failed to unlock work queue", work_queue_mutex);
     }
-    Pthread_mutex_unlock(abort_exec, "router_solve: failed to unlock work queue", work_queue_mutex);
 
     if (coordinatePairPtr == NULL) {
       break;
     }
+    contention_beginNet(myContentionPtr);
 
     coordinate_t* srcPtr = coordinatePairPtr->firstPtr;
     coordinate_t* dstPtr = coordinatePairPtr->secondPtr;
@@ -333,47 +2550,104 @@ void *router_solve (void* argPtr){
     bool_t success = FALSE;
     bool_t merge_success = TRUE;
     vector_t* pointVectorPtr = NULL;
+    path_t* pathPtr = NULL;
 
-    /* create a copy of the grid, over which the expansion and trace back phases will be executed. */
-    grid_copy(myGridPtr, gridPtr);
-    if (doExpansion(routerPtr, myGridPtr, myExpansionQueuePtr, srcPtr, dstPtr)) {
-      pointVectorPtr = doTraceback(gridPtr, myGridPtr, dstPtr, bendCost);
-      if (pointVectorPtr) {
-        merge_success = FALSE;
-        success = FALSE;
-        if ((merge_success = grid_checkPath_Ptr(gridPtr, pointVectorPtr)) == TRUE) 
-          grid_addPath_Ptr(gridPtr, pointVectorPtr);
+    /* expansion and traceback run over a private copy of (a window of) the grid */
+    pointVectorPtr = findPathWindowed(routerPtr, gridPtr, myGridPtr, myWorkspacePtr, srcPtr, dstPtr);
+    /* encoded before it is claimed: a path path_alloc rejects is a failed one */
+    if (pointVectorPtr) {
+      pathPtr = path_alloc(gridPtr, pointVectorPtr);
+    }
+    if (pathPtr) {
+      success = TRUE;
+      /* versions the private grid saw vouch for a path only if it was read through it */
+      grid_t* readerPtr = (myWorkspacePtr->isSharedRead ? NULL : myGridPtr);
+      merge_success = grid_checkPath_Ptr(gridPtr, readerPtr, myContentionPtr, myWorkspacePtr->claimPtr, pointVectorPtr);
+      /* a path other nets cut across is mended where they cut it, not routed again */
+      long numRound = 0;
+      while (!merge_success && routerPtr->repairMargin >= 0 && numRound < REPAIR_MAX_ROUNDS) {
+        vector_t* repairedVectorPtr = repairPath(routerPtr, gridPtr, myGridPtr, myWorkspacePtr, pointVectorPtr);
+        if (repairedVectorPtr == NULL) {
+          break;
+        }
+        path_t* repairedPathPtr = path_alloc(gridPtr, repairedVectorPtr);
+        if (repairedPathPtr == NULL) {
+          break;
+        }
+        path_free(pathPtr);
+        pathPtr = repairedPathPtr;
+        pointVectorPtr = repairedVectorPtr;
+        numRound++;
+        merge_success = grid_checkPath_Ptr(gridPtr, NULL, myContentionPtr, myWorkspacePtr->claimPtr, pointVectorPtr);
+      }
+      if (merge_success) {
+        grid_addPath_Ptr(gridPtr, myWorkspacePtr->claimPtr, pointVectorPtr);
+        if (numRound > 0) {
+          myWorkspacePtr->stats.repairs++;
+        }
       }
     }
     
 
+    if (partitionPtr) {
+      Pthread_mutex_lock(abort_exec, "router_solve: failed to lock work queue", work_queue_mutex);
+      partition_release(partitionPtr, coordinatePairPtr);
+      Pthread_mutex_unlock(abort_exec, "router_solve: failed to unlock work queue", work_queue_mutex);
+    }
+
     if (success) {
       if (merge_success) {
-        bool_t status = vector_pushBack(myPathVectorPtr,(void*)pointVectorPtr);
+        bool_t status = vector_pushBack(myPathVectorPtr, (void*)pathPtr);
         assert(status);
         pair_free(coordinatePairPtr);
       }
       else {
         // failed, retry
-        Pthread_mutex_lock(abort_exec, "router_solve: failed to lock work queue", work_queue_mutex); 
-        queue_push(workQueuePtr, (void*)coordinatePairPtr);
-        Pthread_mutex_unlock(abort_exec, "router_solve: failed to unlock work queue", work_queue_mutex);
-        if (pointVectorPtr) vector_free(pointVectorPtr);
+        path_free(pathPtr);
+        myWorkspacePtr->stats.retries++;
+        if (stealPtr) {
+          steal_push(stealPtr, myDeque, (void*)coordinatePairPtr);
+        } else {
+          Pthread_mutex_lock(abort_exec, "router_solve: failed to lock work queue", work_queue_mutex); 
+          queue_push(workQueuePtr, (void*)coordinatePairPtr);
+          Pthread_mutex_unlock(abort_exec, "router_solve: failed to unlock work queue", work_queue_mutex);
+        }
       }
     }
+    else {
+      /* unroutable on the current grid: drop it */
+      pair_free(coordinatePairPtr);
+    }
     
   }
 
+  /* out of nets: help the threads still routing with their long ones */
+  if (routerArgPtr->crewPtr) {
+    crew_help(routerArgPtr->crewPtr, &myWorkspacePtr->stats);
+  }
+
   /*
    * Add my paths to global list
    */
   list_t* pathVectorListPtr = routerArgPtr->pathVectorListPtr;
   Pthread_mutex_lock(abort_exec, "router_solve: failed to lock list", list_mutex);
   list_insert(pathVectorListPtr, (void*)myPathVectorPtr);
+  router_stats_t* statsPtr = routerArgPtr->statsPtr;
+  statsPtr->pushes += myWorkspacePtr->stats.pushes;
+  statsPtr->expansions += myWorkspacePtr->stats.expansions;
+  statsPtr->reexpansions += myWorkspacePtr->stats.reexpansions;
+  statsPtr->retries += myWorkspacePtr->stats.retries;
+  statsPtr->joins += myWorkspacePtr->stats.joins;
+  statsPtr->steals += myWorkspacePtr->stats.steals;
+  statsPtr->repairs += myWorkspacePtr->stats.repairs;
+  statsPtr->attempts += myContentionPtr->numAttempt;
+  statsPtr->busy += myContentionPtr->numBusy;
+  statsPtr->aborts += myContentionPtr->numAbort;
   Pthread_mutex_unlock(abort_exec, "router_solve: failed to unlock list", list_mutex);
 
   grid_free(myGridPtr);
-  queue_free(myExpansionQueuePtr);
+  workspace_free(myWorkspacePtr);
+  contention_free(myContentionPtr);
   return NULL;
 }
 
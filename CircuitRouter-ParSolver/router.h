@@ -55,24 +55,95 @@
 #define ROUTER_H 1
 
 
+#include "batch.h"
 #include "grid.h"
 #include "maze.h"
+#include "contention.h"
+#include "partition.h"
+#include "steal.h"
 #include "lib/vector.h"
 #include <pthread.h>
 
+typedef enum router_expansion {
+  ROUTER_EXPANSION_INVALID = -1,
+  ROUTER_EXPANSION_LEE = 0,   /* breadth-first Lee wavefront from the source */
+  ROUTER_EXPANSION_ASTAR,     /* goal-directed, ordered by cost + distance to go */
+  ROUTER_EXPANSION_BIDIR,     /* Lee waves from both ends, stopping where they meet */
+  ROUTER_EXPANSION_DIAL,      /* Lee wave in cost order (bucket queue), no re-expansions */
+  ROUTER_EXPANSION_BITSET,    /* BFS over occupancy bits, 64 cells per word; equal x/y/z costs only */
+  ROUTER_EXPANSION_SWEEP,     /* whole-row SIMD relaxation sweeps until the costs settle */
+  ROUTER_EXPANSION_DELTA,     /* delta-stepping, shared with the threads left without nets */
+} router_expansion_t;
+
+typedef enum router_scratch {
+  ROUTER_SCRATCH_INVALID = -1,
+  ROUTER_SCRATCH_COPY = 0,    /* private copy of the grid, refreshed for every net */
+  ROUTER_SCRATCH_EPOCH,       /* epoch-stamped private grid, reset in O(1) per net */
+} router_scratch_t;
+
+typedef enum router_traceback {
+  ROUTER_TRACEBACK_INVALID = -1,
+  ROUTER_TRACEBACK_SCAN = 0,  /* follow decreasing labels, scanning six neighbors per cell */
+  ROUTER_TRACEBACK_ARRIVAL,   /* follow the move recorded into each cell (lee, astar and dial only) */
+} router_traceback_t;
+
+typedef enum router_schedule {
+  ROUTER_SCHEDULE_INVALID = -1,
+  ROUTER_SCHEDULE_NETS = 0,   /* one net per thread; threads out of nets only help long ones (deltaThreshold) */
+  ROUTER_SCHEDULE_HYBRID,     /* once fewer nets are queued than threads, route them as delta teams idle threads join */
+  ROUTER_SCHEDULE_SPATIAL,    /* prefer nets whose bounding box overlaps none being routed (partition.h) */
+  ROUTER_SCHEDULE_STEAL,      /* nets dealt out to per-thread deques, stolen from when one runs dry (steal.h) */
+  ROUTER_SCHEDULE_BATCH,      /* deterministic: batches routed against the same grid, committed in net order (batch.h) */
+} router_schedule_t;
+
 typedef struct router {
   long xCost;
   long yCost;
   long zCost;
   long bendCost;
+  router_expansion_t expansion;
+  long windowMargin; /* < 0: expand over the whole grid */
+  router_scratch_t scratch;
+  long cellBits;     /* 64, 32 or 16: narrowest cells allowed in private grids */
+  router_traceback_t traceback;
+  long negotiateIterations; /* > 0: negotiated congestion rounds (negotiate.h) instead of commit retries */
+  long negotiateBudget;     /* milliseconds per negotiation round, 0: unbounded */
+  long deltaThreshold;      /* >= 0: nets at least this long go delta-stepping when threads are idle */
+  router_schedule_t schedule;
+  long repairMargin;        /* >= 0: a path found taken is repaired in a window this much wider than the stretch lost */
 } router_t;
 
+/* threads out of nets, lending a hand with the expansion of long ones */
+typedef struct router_crew router_crew_t;
+
+typedef struct router_stats {
+  long pushes;       /* cells inserted in an expansion queue */
+  long expansions;   /* cells whose neighbors were scanned */
+  long reexpansions; /* cells queued to be expanded again after a cheaper relabel */
+  long retries;      /* nets requeued because their path no longer fit the shared grid, or ripped up */
+  long iterations;   /* negotiation rounds, or batches, run */
+  long joins;        /* threads out of nets joining a delta team */
+  long deferrals;    /* nets passed over as overlapping nets being routed */
+  long overlaps;     /* nets routed over overlapping ones, nothing else being left */
+  long steals;       /* nets taken from another thread's deque */
+  long repairs;      /* paths committed after a detour around the points taken, instead of a requeue */
+  long attempts;     /* path commits tried */
+  long busy;         /* points (or locks) a commit found held by another */
+  long aborts;       /* commits given up on a busy point, or transactions rerun */
+} router_stats_t;
+
 typedef struct router_solve_arg {
   router_t* routerPtr;
   maze_t* mazePtr;
   list_t* pathVectorListPtr;
   pthread_mutex_t * workQueueMutex;
-  pthread_mutex_t * listMutex;
+  pthread_mutex_t * listMutex; /* also guards statsPtr */
+  router_stats_t* statsPtr;
+  router_crew_t* crewPtr;      /* NULL: threads stop once the work queue is empty */
+  partition_t* partitionPtr;   /* NULL: nets are taken in queue order */
+  steal_t* stealPtr;           /* NULL: nets are taken from the maze's work queue */
+  contention_manager_t* contentionManagerPtr;
+  batch_t* batchPtr;           /* NULL: paths are committed as soon as they are found */
 } router_solve_arg_t;
 
 
@@ -80,7 +151,7 @@ typedef struct router_solve_arg {
  * router_alloc
  * =============================================================================
  */
-router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost);
+router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost, router_expansion_t expansion);
 
 
 /* =============================================================================
@@ -90,6 +161,63 @@ router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost);
 void router_free (router_t* routerPtr);
 
 
+/* =============================================================================
+ * router_crew_alloc
+ * -- For numThread threads running router_solve
+ * =============================================================================
+ */
+router_crew_t* router_crew_alloc (long numThread);
+
+
+/* =============================================================================
+ * router_crew_free
+ * =============================================================================
+ */
+void router_crew_free (router_crew_t* crewPtr);
+
+
+/* =============================================================================
+ * router_parseExpansion
+ * -- Returns ROUTER_EXPANSION_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_expansion_t router_parseExpansion (const char* name);
+
+
+/* =============================================================================
+ * router_parseScratch
+ * -- Returns ROUTER_SCRATCH_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_scratch_t router_parseScratch (const char* name);
+
+
+/* =============================================================================
+ * router_parseTraceback
+ * -- Returns ROUTER_TRACEBACK_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_traceback_t router_parseTraceback (const char* name);
+
+
+/* =============================================================================
+ * router_parseSchedule
+ * -- Returns ROUTER_SCHEDULE_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_schedule_t router_parseSchedule (const char* name);
+
+
+/* =============================================================================
+ * router_selectCellType
+ * -- Cells of the private grids: the narrowest the router's cellBits allows
+ *    that holds every label on the grid, so narrow cells only suit small
+ *    boards (16 bits: up to 32764 / max move cost points)
+ * =============================================================================
+ */
+grid_cell_t router_selectCellType (router_t* routerPtr, grid_t* gridPtr);
+
+
 /* =============================================================================
  * router_solve
  * =============================================================================
@@ -0,0 +1,238 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * steal.c
+ *
+ * per-thread net deques with work stealing (Chase-Lev)
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "lib/queue.h"
+#include "steal.h"
+#include "lib/types.h"
+#include "lib/vector.h"
+
+
+typedef enum steal_result {
+  STEAL_EMPTY = 0,
+  STEAL_LOST,      /* the deque was not empty, but another thread won its top */
+  STEAL_SUCCESS,
+} steal_result_t;
+
+
+/* =============================================================================
+ * deque_init
+ * -- Room for numElement elements
+ * =============================================================================
+ */
+static void deque_init (steal_deque_t* dequePtr, long numElement){
+  long capacity = 1;
+  while (capacity < numElement) {
+    capacity <<= 1;
+  }
+  dequePtr->top = 0;
+  dequePtr->bottom = 0;
+  dequePtr->elements = (void**)malloc(capacity * sizeof(void*));
+  assert(dequePtr->elements);
+  dequePtr->mask = capacity - 1;
+}
+
+
+/* =============================================================================
+ * deque_push
+ * =============================================================================
+ */
+static void deque_push (steal_deque_t* dequePtr, void* dataPtr){
+  long bottom = __atomic_load_n(&dequePtr->bottom, __ATOMIC_RELAXED);
+  assert(bottom - __atomic_load_n(&dequePtr->top, __ATOMIC_ACQUIRE) <= dequePtr->mask);
+  __atomic_store_n(&dequePtr->elements[bottom & dequePtr->mask], dataPtr, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&dequePtr->bottom, (bottom + 1), __ATOMIC_RELAXED);
+}
+
+
+/* =============================================================================
+ * deque_pop
+ * -- Owner side; returns NULL if empty
+ * =============================================================================
+ */
+static void* deque_pop (steal_deque_t* dequePtr){
+  long bottom = __atomic_load_n(&dequePtr->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&dequePtr->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long top = __atomic_load_n(&dequePtr->top, __ATOMIC_RELAXED);
+
+  void* dataPtr = NULL;
+  if (top <= bottom) {
+    dataPtr = __atomic_load_n(&dequePtr->elements[bottom & dequePtr->mask], __ATOMIC_RELAXED);
+    if (top == bottom) {
+      /* the last one: thieves may be after it too */
+      if (!__atomic_compare_exchange_n(&dequePtr->top, &top, (top + 1),
+                                       FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        dataPtr = NULL;
+      }
+      __atomic_store_n(&dequePtr->bottom, (bottom + 1), __ATOMIC_RELAXED);
+    }
+  } else {
+    __atomic_store_n(&dequePtr->bottom, (bottom + 1), __ATOMIC_RELAXED);
+  }
+
+  return dataPtr;
+}
+
+
+/* =============================================================================
+ * deque_steal
+ * -- Thief side; the element is stored in *dataPtrPtr on success
+ * =============================================================================
+ */
+static steal_result_t deque_steal (steal_deque_t* dequePtr, void** dataPtrPtr){
+  long top = __atomic_load_n(&dequePtr->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long bottom = __atomic_load_n(&dequePtr->bottom, __ATOMIC_ACQUIRE);
+  if (top >= bottom) {
+    return STEAL_EMPTY;
+  }
+
+  void* dataPtr = __atomic_load_n(&dequePtr->elements[top & dequePtr->mask], __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&dequePtr->top, &top, (top + 1),
+                                   FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    return STEAL_LOST;
+  }
+  *dataPtrPtr = dataPtr;
+
+  return STEAL_SUCCESS;
+}
+
+
+/* =============================================================================
+ * steal_alloc
+ * -- Deals the elements of workQueuePtr (emptied) out to numThread deques,
+ *    each keeping their queue order
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+steal_t* steal_alloc (long numThread, queue_t* workQueuePtr){
+  steal_t* stealPtr = (steal_t*)malloc(sizeof(steal_t));
+  if (stealPtr == NULL) {
+    return NULL;
+  }
+  stealPtr->deques_unaligned = (steal_deque_t*)malloc((numThread + 1) * sizeof(steal_deque_t));
+  if (stealPtr->deques_unaligned == NULL) {
+    free(stealPtr);
+    return NULL;
+  }
+  stealPtr->deques = (steal_deque_t*)((char*)(((unsigned long)stealPtr->deques_unaligned
+                     & ~(STEAL_PAD_BYTES-1)))
+                 + STEAL_PAD_BYTES);
+  stealPtr->numDeque = numThread;
+  stealPtr->numJoined = 0;
+
+  vector_t* elementVectorPtr = vector_alloc(1);
+  assert(elementVectorPtr);
+  while (!queue_isEmpty(workQueuePtr)) {
+    bool_t status = vector_pushBack(elementVectorPtr, queue_pop(workQueuePtr));
+    assert(status);
+  }
+  long numElement = vector_getSize(elementVectorPtr);
+
+  /* any deque may end up with every element, after steals and retries */
+  long d;
+  for (d = 0; d < numThread; d++) {
+    deque_init(&stealPtr->deques[d], numElement);
+  }
+
+  /* the owner takes from the bottom: push its share last to first */
+  long last = numElement - 1;
+  for (d = 0; d < numThread; d++) {
+    long i;
+    for (i = last - ((last - d + numThread) % numThread); i >= d; i -= numThread) {
+      deque_push(&stealPtr->deques[d], vector_at(elementVectorPtr, i));
+    }
+  }
+  vector_free(elementVectorPtr);
+
+  return stealPtr;
+}
+
+
+/* =============================================================================
+ * steal_free
+ * =============================================================================
+ */
+void steal_free (steal_t* stealPtr){
+  long d;
+  for (d = 0; d < stealPtr->numDeque; d++) {
+    free(stealPtr->deques[d].elements);
+  }
+  free(stealPtr->deques_unaligned);
+  free(stealPtr);
+}
+
+
+/* =============================================================================
+ * steal_join
+ * -- Returns the deque of the calling thread; each thread calls it once
+ * =============================================================================
+ */
+long steal_join (steal_t* stealPtr){
+  long id = __atomic_fetch_add(&stealPtr->numJoined, 1, __ATOMIC_RELAXED);
+  assert(id < stealPtr->numDeque);
+  return id;
+}
+
+
+/* =============================================================================
+ * steal_push
+ * -- Owner only: the element is the next one it takes
+ * =============================================================================
+ */
+void steal_push (steal_t* stealPtr, long id, void* dataPtr){
+  deque_push(&stealPtr->deques[id], dataPtr);
+}
+
+
+/* =============================================================================
+ * steal_take
+ * -- Owner only: takes from its own deque, or steals from the others once it
+ *    is empty, adding the elements stolen to *numStealPtr
+ * -- Returns NULL once every deque was seen empty
+ * =============================================================================
+ */
+void* steal_take (steal_t* stealPtr, long id, long* numStealPtr){
+  void* dataPtr = deque_pop(&stealPtr->deques[id]);
+  if (dataPtr) {
+    return dataPtr;
+  }
+
+  /* victims in turn from the next thread on; a lost race means work was left */
+  long numDeque = stealPtr->numDeque;
+  bool_t isLost;
+  do {
+    isLost = FALSE;
+    long k;
+    for (k = 1; k < numDeque; k++) {
+      steal_deque_t* victimPtr = &stealPtr->deques[(id + k) % numDeque];
+      steal_result_t result = deque_steal(victimPtr, &dataPtr);
+      if (result == STEAL_SUCCESS) {
+        (*numStealPtr)++;
+        return dataPtr;
+      }
+      if (result == STEAL_LOST) {
+        isLost = TRUE;
+      }
+    }
+  } while (isLost);
+
+  return NULL;
+}
+
+
+/* =============================================================================
+ *
+ * End of steal.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,97 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * steal.h
+ *
+ * per-thread net deques with work stealing (Chase and Lev, as formalized
+ * for weak memory by Le et al.): the nets of the work queue are dealt out
+ * round-robin when routing starts, each thread then takes its own nets from
+ * the bottom of its deque, and one that runs dry steals from the top of the
+ * others'. No lock is taken; only a steal racing the owner for a deque's
+ * last net costs a compare-and-swap
+ *
+ * a deque never holds more than the nets dealt out, so it is sized once and
+ * never grows
+ * =============================================================================
+ */
+
+
+#ifndef STEAL_H
+#define STEAL_H 1
+
+
+#include "lib/queue.h"
+
+enum steal_config {
+  STEAL_PAD_BYTES = 64, /* keeps top and bottom on separate cache lines */
+};
+
+typedef struct steal_deque {
+  long top;            /* next to steal; only ever increases */
+  char padTop[STEAL_PAD_BYTES - sizeof(long)];
+  long bottom;         /* next free slot, owner side */
+  char padBottom[STEAL_PAD_BYTES - sizeof(long)];
+  void** elements;     /* ring of mask + 1 slots */
+  long mask;
+  char padEnd[STEAL_PAD_BYTES - sizeof(void**) - sizeof(long)];
+} steal_deque_t;
+
+typedef struct steal {
+  steal_deque_t* deques_unaligned;
+  steal_deque_t* deques;
+  long numDeque;
+  long numJoined;      /* deques handed out by steal_join */
+} steal_t;
+
+
+/* =============================================================================
+ * steal_alloc
+ * -- Deals the elements of workQueuePtr (emptied) out to numThread deques,
+ *    each keeping their queue order
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+steal_t* steal_alloc (long numThread, queue_t* workQueuePtr);
+
+
+/* =============================================================================
+ * steal_free
+ * =============================================================================
+ */
+void steal_free (steal_t* stealPtr);
+
+
+/* =============================================================================
+ * steal_join
+ * -- Returns the deque of the calling thread; each thread calls it once
+ * =============================================================================
+ */
+long steal_join (steal_t* stealPtr);
+
+
+/* =============================================================================
+ * steal_push
+ * -- Owner only: the element is the next one it takes
+ * =============================================================================
+ */
+void steal_push (steal_t* stealPtr, long id, void* dataPtr);
+
+
+/* =============================================================================
+ * steal_take
+ * -- Owner only: takes from its own deque, or steals from the others once it
+ *    is empty, adding the elements stolen to *numStealPtr
+ * -- Returns NULL once every deque was seen empty
+ * =============================================================================
+ */
+void* steal_take (steal_t* stealPtr, long id, long* numStealPtr);
+
+
+#endif /* STEAL_H */
+
+
+/* =============================================================================
+ *
+ * End of steal.h
+ *
+ * =============================================================================
+ */
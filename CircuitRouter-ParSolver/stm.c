@@ -0,0 +1,297 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * stm.c
+ *
+ * word-based software transactional memory (TL2 style)
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "contention.h"
+#include "stm.h"
+#include "lib/types.h"
+#include "lib/utility.h"
+
+
+/* =============================================================================
+ * getLock
+ * -- Consecutive words get consecutive locks
+ * =============================================================================
+ */
+static inline unsigned long* getLock (stm_t* stmPtr, long* addr){
+  return &stmPtr->locks[((unsigned long)addr / sizeof(long)) & ((1UL << STM_LOCK_BITS) - 1)];
+}
+
+
+/* =============================================================================
+ * stm_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+stm_t* stm_alloc (void){
+  stm_t* stmPtr = (stm_t*)malloc(sizeof(stm_t));
+  if (stmPtr == NULL) {
+    return NULL;
+  }
+  stmPtr->locks = (unsigned long*)calloc((1UL << STM_LOCK_BITS), sizeof(unsigned long));
+  if (stmPtr->locks == NULL) {
+    free(stmPtr);
+    return NULL;
+  }
+  stmPtr->clock = 0;
+
+  return stmPtr;
+}
+
+
+/* =============================================================================
+ * stm_free
+ * =============================================================================
+ */
+void stm_free (stm_t* stmPtr){
+  free(stmPtr->locks);
+  free(stmPtr);
+}
+
+
+/* =============================================================================
+ * stm_txInit
+ * -- An empty transaction, with no room until stm_txReserve
+ * =============================================================================
+ */
+void stm_txInit (stm_tx_t* txPtr){
+  txPtr->stmPtr = NULL;
+  txPtr->capacity = 0;
+  txPtr->reads = NULL;
+  txPtr->numRead = 0;
+  txPtr->writeAddrs = NULL;
+  txPtr->writeValues = NULL;
+  txPtr->writeLocks = NULL;
+  txPtr->numWrite = 0;
+  txPtr->contentionPtr = NULL;
+  txPtr->numRerun = 0;
+}
+
+
+/* =============================================================================
+ * stm_txReserve
+ * -- Readies the transaction for up to capacity reads and capacity writes
+ *    on stmPtr; the room only grows, so a transaction reused from path to
+ *    path allocates only for the longest one yet
+ * -- Aborts are counted and backed off by contentionPtr
+ * -- Returns FALSE on failure, with the room held so far kept
+ * =============================================================================
+ */
+bool_t stm_txReserve (stm_tx_t* txPtr, stm_t* stmPtr, long capacity, contention_t* contentionPtr){
+  txPtr->stmPtr = stmPtr;
+  txPtr->numRead = 0;
+  txPtr->numWrite = 0;
+  txPtr->contentionPtr = contentionPtr;
+  txPtr->numRerun = 0;
+
+  if (capacity <= txPtr->capacity) {
+    return TRUE;
+  }
+  long newCapacity = MAX(capacity, (2 * txPtr->capacity));
+
+  long** reads = (long**)realloc(txPtr->reads, newCapacity * sizeof(long*));
+  if (reads == NULL) {
+    return FALSE;
+  }
+  txPtr->reads = reads;
+  long** writeAddrs = (long**)realloc(txPtr->writeAddrs, newCapacity * sizeof(long*));
+  if (writeAddrs == NULL) {
+    return FALSE;
+  }
+  txPtr->writeAddrs = writeAddrs;
+  long* writeValues = (long*)realloc(txPtr->writeValues, newCapacity * sizeof(long));
+  if (writeValues == NULL) {
+    return FALSE;
+  }
+  txPtr->writeValues = writeValues;
+  unsigned long* writeLocks = (unsigned long*)realloc(txPtr->writeLocks, newCapacity * sizeof(unsigned long));
+  if (writeLocks == NULL) {
+    return FALSE;
+  }
+  txPtr->writeLocks = writeLocks;
+  txPtr->capacity = newCapacity;
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * stm_txFree
+ * =============================================================================
+ */
+void stm_txFree (stm_tx_t* txPtr){
+  free(txPtr->reads);
+  free(txPtr->writeAddrs);
+  free(txPtr->writeValues);
+  free(txPtr->writeLocks);
+}
+
+
+/* =============================================================================
+ * stm_txBegin
+ * =============================================================================
+ */
+void stm_txBegin (stm_tx_t* txPtr){
+  txPtr->readVersion = __atomic_load_n(&txPtr->stmPtr->clock, __ATOMIC_ACQUIRE);
+  txPtr->numRead = 0;
+  txPtr->numWrite = 0;
+}
+
+
+/* =============================================================================
+ * stm_txRead
+ * -- Stores the word at addr in *valuePtr
+ * -- Returns FALSE if the transaction can no longer commit: call
+ *    stm_txAbort and rerun it
+ * =============================================================================
+ */
+bool_t stm_txRead (stm_tx_t* txPtr, long* addr, long* valuePtr){
+  assert(txPtr->numWrite == 0);
+  assert(txPtr->numRead < txPtr->capacity);
+
+  /* the word is only good if its lock is free and unchanged around it */
+  unsigned long* lockPtr = getLock(txPtr->stmPtr, addr);
+  unsigned long before = __atomic_load_n(lockPtr, __ATOMIC_ACQUIRE);
+  long value = __atomic_load_n(addr, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  unsigned long after = __atomic_load_n(lockPtr, __ATOMIC_RELAXED);
+  if ((before & 1) || before != after || (before >> 1) > txPtr->readVersion) {
+    return FALSE;
+  }
+
+  txPtr->reads[txPtr->numRead++] = addr;
+  *valuePtr = value;
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * stm_txWrite
+ * -- Buffered until stm_txCommit
+ * =============================================================================
+ */
+void stm_txWrite (stm_tx_t* txPtr, long* addr, long value){
+  assert(txPtr->numWrite < txPtr->capacity);
+  txPtr->writeAddrs[txPtr->numWrite] = addr;
+  txPtr->writeValues[txPtr->numWrite] = value;
+  txPtr->numWrite++;
+}
+
+
+/* =============================================================================
+ * releaseLocks
+ * -- To the given version, or back to where they were if 0
+ * =============================================================================
+ */
+static void releaseLocks (stm_tx_t* txPtr, long numTaken, unsigned long version){
+  long i;
+  for (i = 0; i < numTaken; i++) {
+    unsigned long oldWord = txPtr->writeLocks[i];
+    if (oldWord != STM_NOT_TAKEN) {
+      __atomic_store_n(getLock(txPtr->stmPtr, txPtr->writeAddrs[i]),
+                       (version ? (version << 1) : oldWord), __ATOMIC_RELEASE);
+    }
+  }
+}
+
+
+/* =============================================================================
+ * stm_txCommit
+ * -- Returns FALSE if the transaction aborted instead: rerun it
+ * =============================================================================
+ */
+bool_t stm_txCommit (stm_tx_t* txPtr){
+  stm_t* stmPtr = txPtr->stmPtr;
+  unsigned long owner = ((unsigned long)txPtr | 1);
+  long i;
+
+  /* reads alone were each consistent with readVersion */
+  if (txPtr->numWrite == 0) {
+    txPtr->numRerun = 0;
+    return TRUE;
+  }
+
+  /*
+   * Lock the words written, giving up on a lock held for as long as the
+   * contention manager allows rather than risk waiting in a cycle; every
+   * word written here was read first, so a lock newer than readVersion
+   * already means a conflict
+   */
+  for (i = 0; i < txPtr->numWrite; i++) {
+    unsigned long* lockPtr = getLock(stmPtr, txPtr->writeAddrs[i]);
+    long numPoll = 0;
+    txPtr->writeLocks[i] = STM_NOT_TAKEN;
+    while (1) {
+      unsigned long word = __atomic_load_n(lockPtr, __ATOMIC_RELAXED);
+      if (word == owner) {
+        break; /* words sharing a lock */
+      }
+      if (!(word & 1)) {
+        if ((word >> 1) > txPtr->readVersion) {
+          releaseLocks(txPtr, i, 0);
+          stm_txAbort(txPtr);
+          return FALSE;
+        }
+        if (__atomic_compare_exchange_n(lockPtr, &word, owner,
+                                        FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+          txPtr->writeLocks[i] = word;
+          break;
+        }
+      } else if (!contention_wait(txPtr->contentionPtr, ++numPoll)) {
+        releaseLocks(txPtr, i, 0);
+        stm_txAbort(txPtr);
+        return FALSE;
+      }
+    }
+  }
+
+  unsigned long writeVersion = __atomic_add_fetch(&stmPtr->clock, 1, __ATOMIC_ACQ_REL);
+
+  /* no commit in between: the reads cannot have changed */
+  if (writeVersion != txPtr->readVersion + 1) {
+    for (i = 0; i < txPtr->numRead; i++) {
+      unsigned long word = __atomic_load_n(getLock(stmPtr, txPtr->reads[i]), __ATOMIC_ACQUIRE);
+      if (word != owner && ((word & 1) || (word >> 1) > txPtr->readVersion)) {
+        releaseLocks(txPtr, txPtr->numWrite, 0);
+        stm_txAbort(txPtr);
+        return FALSE;
+      }
+    }
+  }
+
+  for (i = 0; i < txPtr->numWrite; i++) {
+    __atomic_store_n(txPtr->writeAddrs[i], txPtr->writeValues[i], __ATOMIC_RELAXED);
+  }
+  releaseLocks(txPtr, txPtr->numWrite, writeVersion);
+  txPtr->numRerun = 0;
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * stm_txAbort
+ * -- Drops the transaction after a failed read, backing off before it is
+ *    rerun; one that simply stops (before any write) needs no call, and a
+ *    failed stm_txCommit has made it already
+ * =============================================================================
+ */
+void stm_txAbort (stm_tx_t* txPtr){
+  txPtr->numRerun++;
+  contention_abort(txPtr->contentionPtr, txPtr->numRerun);
+}
+
+
+/* =============================================================================
+ *
+ * End of stm.c
+ *
+ * =============================================================================
+ */
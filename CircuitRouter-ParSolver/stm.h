@@ -0,0 +1,150 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * stm.h
+ *
+ * word-based software transactional memory in the style of TL2 (Dice,
+ * Shalev and Shavit): a global version clock and a table of versioned
+ * write locks, each guarding the words whose address hashes to it
+ *
+ * a transaction samples the clock when it begins, and a word it reads must
+ * be unlocked and no newer than that; writes are buffered until commit,
+ * which locks the words written, takes a new version from the clock,
+ * checks the reads again, writes back and unlocks with the new version.
+ * Any conflict aborts the transaction, which the caller reruns once the
+ * contention manager has backed it off
+ *
+ * reads must all come before the first write of a transaction (the
+ * router's commits read every point of a path, then write them all)
+ * =============================================================================
+ */
+
+
+#ifndef STM_H
+#define STM_H 1
+
+
+#include "contention.h"
+#include "lib/types.h"
+
+enum stm_config {
+  STM_LOCK_BITS = 16,     /* versioned locks: 1 << STM_LOCK_BITS of them */
+  STM_PAD_BYTES = 64,     /* keeps the clock away from the locks' pointer */
+};
+
+#define STM_NOT_TAKEN (~0UL)
+
+typedef struct stm {
+  unsigned long clock;
+  char padClock[STM_PAD_BYTES - sizeof(unsigned long)];
+  unsigned long* locks;   /* version << 1, or the owner's descriptor | 1 while locked */
+} stm_t;
+
+typedef struct stm_tx {
+  stm_t* stmPtr;
+  unsigned long readVersion;
+  long capacity;          /* reads, and writes, a transaction holds at most */
+  long** reads;
+  long numRead;
+  long** writeAddrs;
+  long* writeValues;
+  unsigned long* writeLocks; /* per write: its lock's word before this commit took it, or STM_NOT_TAKEN */
+  long numWrite;
+  contention_t* contentionPtr; /* of the thread running it */
+  long numRerun;          /* aborts in a row */
+} stm_tx_t;
+
+
+/* =============================================================================
+ * stm_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+stm_t* stm_alloc (void);
+
+
+/* =============================================================================
+ * stm_free
+ * =============================================================================
+ */
+void stm_free (stm_t* stmPtr);
+
+
+/* =============================================================================
+ * stm_txInit
+ * -- An empty transaction, with no room until stm_txReserve
+ * =============================================================================
+ */
+void stm_txInit (stm_tx_t* txPtr);
+
+
+/* =============================================================================
+ * stm_txReserve
+ * -- Readies the transaction for up to capacity reads and capacity writes
+ *    on stmPtr; the room only grows, so a transaction reused from path to
+ *    path allocates only for the longest one yet
+ * -- Aborts are counted and backed off by contentionPtr
+ * -- Returns FALSE on failure, with the room held so far kept
+ * =============================================================================
+ */
+bool_t stm_txReserve (stm_tx_t* txPtr, stm_t* stmPtr, long capacity, contention_t* contentionPtr);
+
+
+/* =============================================================================
+ * stm_txFree
+ * =============================================================================
+ */
+void stm_txFree (stm_tx_t* txPtr);
+
+
+/* =============================================================================
+ * stm_txBegin
+ * =============================================================================
+ */
+void stm_txBegin (stm_tx_t* txPtr);
+
+
+/* =============================================================================
+ * stm_txRead
+ * -- Stores the word at addr in *valuePtr
+ * -- Returns FALSE if the transaction can no longer commit: call
+ *    stm_txAbort and rerun it
+ * =============================================================================
+ */
+bool_t stm_txRead (stm_tx_t* txPtr, long* addr, long* valuePtr);
+
+
+/* =============================================================================
+ * stm_txWrite
+ * -- Buffered until stm_txCommit
+ * =============================================================================
+ */
+void stm_txWrite (stm_tx_t* txPtr, long* addr, long value);
+
+
+/* =============================================================================
+ * stm_txCommit
+ * -- Returns FALSE if the transaction aborted instead: rerun it
+ * =============================================================================
+ */
+bool_t stm_txCommit (stm_tx_t* txPtr);
+
+
+/* =============================================================================
+ * stm_txAbort
+ * -- Drops the transaction after a failed read, backing off before it is
+ *    rerun; one that simply stops (before any write) needs no call, and a
+ *    failed stm_txCommit has made it already
+ * =============================================================================
+ */
+void stm_txAbort (stm_tx_t* txPtr);
+
+
+#endif /* STM_H */
+
+
+/* =============================================================================
+ *
+ * End of stm.h
+ *
+ * =============================================================================
+ */
@@ -69,6 +69,7 @@ enum param_types {
   PARAM_XCOST  = (unsigned char)'x',
   PARAM_YCOST  = (unsigned char)'y',
   PARAM_ZCOST  = (unsigned char)'z',
+  PARAM_EXPANSION = (unsigned char)'e',
 };
 
 enum param_defaults {
@@ -76,6 +77,7 @@ enum param_defaults {
   PARAM_DEFAULT_XCOST  = 1,
   PARAM_DEFAULT_YCOST  = 1,
   PARAM_DEFAULT_ZCOST  = 2,
+  PARAM_DEFAULT_EXPANSION = ROUTER_EXPANSION_LEE,
 };
 
 bool_t global_doPrint = TRUE;
@@ -94,6 +96,7 @@ static void displayUsage (const char* appName){
   fprintf(stderr, "  x       <UINT>  [x] movement cost  (%i)\n", PARAM_DEFAULT_XCOST);
   fprintf(stderr, "  y       <UINT>  [y] movement cost  (%i)\n", PARAM_DEFAULT_YCOST);
   fprintf(stderr, "  z       <UINT>  [z] movement cost  (%i)\n", PARAM_DEFAULT_ZCOST);
+  fprintf(stderr, "  e       <lee|astar>  [e]xpansion engine  (lee)\n");
   fprintf(stderr, "  h           [h]elp message    (false)\n");
   exit(1);
 }
@@ -108,6 +111,7 @@ static void setDefaultParams (){
   global_params[PARAM_XCOST]  = PARAM_DEFAULT_XCOST;
   global_params[PARAM_YCOST]  = PARAM_DEFAULT_YCOST;
   global_params[PARAM_ZCOST]  = PARAM_DEFAULT_ZCOST;
+  global_params[PARAM_EXPANSION] = PARAM_DEFAULT_EXPANSION;
 }
 
 
@@ -122,7 +126,7 @@ static void parseArgs (long argc, char* const argv[]){
 
   setDefaultParams();
 
-  while ((opt = getopt(argc, argv, "hb:x:y:z:")) != -1) {
+  while ((opt = getopt(argc, argv, "hb:x:y:z:e:")) != -1) {
     switch (opt) {
       case 'b':
       case 'x':
@@ -130,6 +134,13 @@ static void parseArgs (long argc, char* const argv[]){
       case 'z':
         global_params[(unsigned char)opt] = atol(optarg);
         break;
+      case 'e':
+        global_params[PARAM_EXPANSION] = router_parseExpansion(optarg);
+        if (global_params[PARAM_EXPANSION] == ROUTER_EXPANSION_INVALID) {
+          fprintf(stderr, "Unknown expansion engine: %s\n", optarg);
+          opterr++;
+        }
+        break;
       case '?':
       case 'h':
       default:
@@ -213,7 +224,8 @@ int main(int argc, char** argv){
   router_t* routerPtr = router_alloc(global_params[PARAM_XCOST],
                     global_params[PARAM_YCOST],
                     global_params[PARAM_ZCOST],
-                    global_params[PARAM_BENDCOST]);
+                    global_params[PARAM_BENDCOST],
+                    global_params[PARAM_EXPANSION]);
   assert(routerPtr);
   list_t* pathVectorListPtr = list_alloc(NULL);
   assert(pathVectorListPtr);
@@ -53,8 +53,10 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include "coordinate.h"
 #include "grid.h"
+#include "lib/heap.h"
 #include "lib/queue.h"
 #include "router.h"
 #include "lib/vector.h"
@@ -85,12 +87,17 @@ point_t MOVE_NEGX = {-1, 0, 0, 0, MOMENTUM_NEGX};
 point_t MOVE_NEGY = { 0, -1, 0, 0, MOMENTUM_NEGY};
 point_t MOVE_NEGZ = { 0, 0, -1, 0, MOMENTUM_NEGZ};
 
+typedef struct router_workspace {
+  queue_t* queuePtr; /* lee */
+  heap_t* heapPtr;   /* astar */
+} router_workspace_t;
+
 
 /* =============================================================================
  * router_alloc
  * =============================================================================
  */
-router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost){
+router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost, router_expansion_t expansion){
   router_t* routerPtr;
 
   routerPtr = (router_t*)malloc(sizeof(router_t));
@@ -99,6 +106,7 @@ router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost){
     routerPtr->yCost = yCost;
     routerPtr->zCost = zCost;
     routerPtr->bendCost = bendCost;
+    routerPtr->expansion = expansion;
   }
 
   return routerPtr;
@@ -113,6 +121,22 @@ void router_free (router_t* routerPtr){
   free(routerPtr);
 }
 
+/* =============================================================================
+ * router_parseExpansion
+ * -- Returns ROUTER_EXPANSION_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_expansion_t router_parseExpansion (const char* name){
+  if (strcmp(name, "lee") == 0) {
+    return ROUTER_EXPANSION_LEE;
+  }
+  if (strcmp(name, "astar") == 0) {
+    return ROUTER_EXPANSION_ASTAR;
+  }
+  return ROUTER_EXPANSION_INVALID;
+}
+
+
 
 /* =============================================================================
  * expandToNeighbor
@@ -190,6 +214,101 @@ static bool_t doExpansion (router_t* routerPtr, grid_t* myGridPtr, queue_t* queu
 }
 
 
+/* =============================================================================
+ * estimateCost
+ * -- Lower bound of the cost of going from (x, y, z) to dst: no path can
+ *    take fewer moves along each axis than the manhattan distance, so this
+ *    is admissible and, since every move changes it by at most its own cost,
+ *    consistent as well
+ * =============================================================================
+ */
+static inline long estimateCost (router_t* routerPtr, long x, long y, long z, coordinate_t* dstPtr){
+  return routerPtr->xCost * labs(x - dstPtr->x) +
+         routerPtr->yCost * labs(y - dstPtr->y) +
+         routerPtr->zCost * labs(z - dstPtr->z);
+}
+
+
+/* =============================================================================
+ * expandToNeighborAStar
+ * -- Same relaxation as expandToNeighbor, but the neighbor is keyed by its
+ *    estimated total cost; ties are broken towards the cell closer to dst
+ * =============================================================================
+ */
+static void expandToNeighborAStar (router_t* routerPtr, grid_t* myGridPtr, long x, long y, long z, long value, coordinate_t* dstPtr, long tieScale, heap_t* heapPtr){
+  if (grid_isPointValid(myGridPtr, x, y, z)) {
+    long* neighborGridPointPtr = grid_getPointRef(myGridPtr, x, y, z);
+    long neighborValue = *neighborGridPointPtr;
+    if (neighborValue == GRID_POINT_FULL) {
+      return;
+    }
+    if (neighborValue == GRID_POINT_EMPTY || value < neighborValue) {
+      long estimate = estimateCost(routerPtr, x, y, z, dstPtr);
+      (*neighborGridPointPtr) = value;
+      heap_insert(heapPtr, (value + estimate) * tieScale + estimate, (void*)neighborGridPointPtr);
+    }
+  }
+}
+
+
+/* =============================================================================
+ * doExpansionAStar
+ * -- Leaves the same cost field as doExpansion along the cells it settles,
+ *    so doTraceback can be used unchanged; cells away from the goal
+ *    direction are simply never labelled
+ * =============================================================================
+ */
+static bool_t doExpansionAStar (router_t* routerPtr, grid_t* myGridPtr, heap_t* heapPtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
+  long xCost = routerPtr->xCost;
+  long yCost = routerPtr->yCost;
+  long zCost = routerPtr->zCost;
+
+  /* every estimate is below tieScale, so (f * tieScale + h) orders by f first, then by h */
+  long tieScale = xCost * myGridPtr->width + yCost * myGridPtr->height + zCost * myGridPtr->depth + 1;
+
+  heap_clear(heapPtr);
+  long* srcGridPointPtr = grid_getPointRef(myGridPtr, srcPtr->x, srcPtr->y, srcPtr->z);
+  long srcEstimate = estimateCost(routerPtr, srcPtr->x, srcPtr->y, srcPtr->z, dstPtr);
+  heap_insert(heapPtr, srcEstimate * tieScale + srcEstimate, (void*)srcGridPointPtr);
+  grid_setPoint(myGridPtr, srcPtr->x, srcPtr->y, srcPtr->z, 0);
+  grid_setPoint(myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z, GRID_POINT_EMPTY);
+  long* dstGridPointPtr = grid_getPointRef(myGridPtr, dstPtr->x, dstPtr->y, dstPtr->z);
+  bool_t isPathFound = FALSE;
+
+  while (!heap_isEmpty(heapPtr)) {
+
+    long key;
+    long* gridPointPtr = (long*)heap_remove(heapPtr, &key);
+    if (gridPointPtr == dstGridPointPtr) {
+      isPathFound = TRUE;
+      break;
+    }
+
+    long x;
+    long y;
+    long z;
+    grid_getPointIndices(myGridPtr, gridPointPtr, &x, &y, &z);
+    long value = (*gridPointPtr);
+
+    /* The cell was relaxed again after this entry was pushed: already expanded */
+    long estimate = estimateCost(routerPtr, x, y, z, dstPtr);
+    if (key != (value + estimate) * tieScale + estimate) {
+      continue;
+    }
+
+    expandToNeighborAStar(routerPtr, myGridPtr, x+1, y,  z,  (value + xCost), dstPtr, tieScale, heapPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, x-1, y,  z,  (value + xCost), dstPtr, tieScale, heapPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, x,  y+1, z,  (value + yCost), dstPtr, tieScale, heapPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, x,  y-1, z,  (value + yCost), dstPtr, tieScale, heapPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, x,  y,  z+1, (value + zCost), dstPtr, tieScale, heapPtr);
+    expandToNeighborAStar(routerPtr, myGridPtr, x,  y,  z-1, (value + zCost), dstPtr, tieScale, heapPtr);
+
+  } /* iterate over work heap */
+
+  return isPathFound;
+}
+
+
 /* =============================================================================
  * traceToNeighbor
  * =============================================================================
@@ -288,6 +407,65 @@ static vector_t* doTraceback (grid_t* gridPtr, grid_t* myGridPtr, coordinate_t*
 }
 
 
+/* =============================================================================
+ * workspace_alloc
+ * -- Per-thread structures needed by the selected expansion engine
+ * =============================================================================
+ */
+static router_workspace_t* workspace_alloc (router_t* routerPtr){
+  router_workspace_t* workspacePtr = (router_workspace_t*)malloc(sizeof(router_workspace_t));
+  assert(workspacePtr);
+
+  workspacePtr->queuePtr = NULL;
+  workspacePtr->heapPtr = NULL;
+
+  switch (routerPtr->expansion) {
+    case ROUTER_EXPANSION_ASTAR:
+      workspacePtr->heapPtr = heap_alloc(1024);
+      assert(workspacePtr->heapPtr);
+      break;
+    case ROUTER_EXPANSION_LEE:
+    default:
+      workspacePtr->queuePtr = queue_alloc(-1);
+      assert(workspacePtr->queuePtr);
+      break;
+  }
+
+  return workspacePtr;
+}
+
+
+/* =============================================================================
+ * workspace_free
+ * =============================================================================
+ */
+static void workspace_free (router_workspace_t* workspacePtr){
+  if (workspacePtr->queuePtr) {
+    queue_free(workspacePtr->queuePtr);
+  }
+  if (workspacePtr->heapPtr) {
+    heap_free(workspacePtr->heapPtr);
+  }
+  free(workspacePtr);
+}
+
+
+/* =============================================================================
+ * expand
+ * -- Runs the expansion engine selected in the router
+ * =============================================================================
+ */
+static bool_t expand (router_t* routerPtr, grid_t* myGridPtr, router_workspace_t* workspacePtr, coordinate_t* srcPtr, coordinate_t* dstPtr){
+  switch (routerPtr->expansion) {
+    case ROUTER_EXPANSION_ASTAR:
+      return doExpansionAStar(routerPtr, myGridPtr, workspacePtr->heapPtr, srcPtr, dstPtr);
+    case ROUTER_EXPANSION_LEE:
+    default:
+      return doExpansion(routerPtr, myGridPtr, workspacePtr->queuePtr, srcPtr, dstPtr);
+  }
+}
+
+
 /* =============================================================================
  * router_solve
  * =============================================================================
@@ -305,7 +483,7 @@ void router_solve (void* argPtr){
   grid_t* myGridPtr = grid_alloc(gridPtr->width, gridPtr->height, gridPtr->depth);
   assert(myGridPtr);
   long bendCost = routerPtr->bendCost;
-  queue_t* myExpansionQueuePtr = queue_alloc(-1);
+  router_workspace_t* myWorkspacePtr = workspace_alloc(routerPtr);
 
   /*
    * Iterate over work list to route each path. This involves an
@@ -332,8 +510,7 @@ void router_solve (void* argPtr){
     vector_t* pointVectorPtr = NULL;
 
     grid_copy(myGridPtr, gridPtr); /* create a copy of the grid, over which the expansion and trace back phases will be executed. */
-    if (doExpansion(routerPtr, myGridPtr, myExpansionQueuePtr,
-             srcPtr, dstPtr)) {
+    if (expand(routerPtr, myGridPtr, myWorkspacePtr, srcPtr, dstPtr)) {
       pointVectorPtr = doTraceback(gridPtr, myGridPtr, dstPtr, bendCost);
       if (pointVectorPtr) {
         grid_addPath_Ptr(gridPtr, pointVectorPtr);
@@ -356,7 +533,7 @@ void router_solve (void* argPtr){
   list_insert(pathVectorListPtr, (void*)myPathVectorPtr);
 
   grid_free(myGridPtr);
-  queue_free(myExpansionQueuePtr);
+  workspace_free(myWorkspacePtr);
 }
 
 
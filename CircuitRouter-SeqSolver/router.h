@@ -59,11 +59,18 @@
 #include "maze.h"
 #include "lib/vector.h"
 
+typedef enum router_expansion {
+  ROUTER_EXPANSION_INVALID = -1,
+  ROUTER_EXPANSION_LEE = 0,   /* breadth-first Lee wavefront from the source */
+  ROUTER_EXPANSION_ASTAR,     /* goal-directed, ordered by cost + distance to go */
+} router_expansion_t;
+
 typedef struct router {
   long xCost;
   long yCost;
   long zCost;
   long bendCost;
+  router_expansion_t expansion;
 } router_t;
 
 typedef struct router_solve_arg {
@@ -77,7 +84,7 @@ typedef struct router_solve_arg {
  * router_alloc
  * =============================================================================
  */
-router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost);
+router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost, router_expansion_t expansion);
 
 
 /* =============================================================================
@@ -87,6 +94,14 @@ router_t* router_alloc (long xCost, long yCost, long zCost, long bendCost);
 void router_free (router_t* routerPtr);
 
 
+/* =============================================================================
+ * router_parseExpansion
+ * -- Returns ROUTER_EXPANSION_INVALID if the name is unknown
+ * =============================================================================
+ */
+router_expansion_t router_parseExpansion (const char* name);
+
+
 /* =============================================================================
  * router_solve
  * =============================================================================
@@ -0,0 +1,57 @@
+#!/usr/bin/bash
+
+# compare the path commit schemes of the ParSolver shared grid: a mutex per
+# point (lock), a CAS per point (cas), a fixed table of tile spinlocks
+# (tile), versioned blocks validated against the versions read while
+# expanding over the shared grid (version) and a TL2-style transaction per
+# path (stm); for each input file and thread count, run every scheme and
+# report the elapsed time, the number of paths routed, the number of nets
+# requeued after a failed commit, the number of commit transactions aborted
+# and rerun (stm only) and the peak resident memory
+
+par="../CircuitRouter-ParSolver/CircuitRouter-ParSolver"
+input_folder='../inputs'
+commits=${COMMITS:-"lock cas tile version stm"}
+threads=${THREADS:-"1 2 4 8 16 32 64"}
+
+if [ $# -ne 0 ]
+then
+  echo "usage: $0 [thread counts in THREADS, extra ParSolver options in OPTS]"
+  exit 1
+elif [[ ! -x $par ]]
+then
+  echo "executable not found"
+  exit 1
+fi
+
+echo -e "#input,\t\tthreads,\tcommit,\ttime,\t\trouted,\tretries,\taborts,\tmaxrss_kb"
+for input in ${input_folder}/*.txt
+do
+  for n in ${threads}
+  do
+    for commit in ${commits}
+    do
+      # bash's time builtin has no memory figure: run it from python instead
+      maxrss=$(python3 -c 'import resource, subprocess, sys
+ret = subprocess.run(sys.argv[1:], stdout=subprocess.DEVNULL).returncode
+print(resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss)
+sys.exit(ret)' ${par} -t $n -k ${commit} ${OPTS} ${input})
+      ret=$?
+      if [[ $ret -ne 0 ]]
+      then
+        echo "An error occurred: ParSolver returned "$ret". Aborting"
+        exit $ret
+      fi
+      if ! grep -q "Verification passed" ${input}.res
+      then
+        echo "Verification failed: "${input}" -t "${n}" -k "${commit}
+        exit 1
+      fi
+      timed=$(grep "Elapsed time" ${input}.res | cut -d " " -f 5)
+      routed=$(grep "Paths routed" ${input}.res | cut -d " " -f 5)
+      retries=$(grep "Retries" ${input}.res | cut -d " " -f 9)
+      aborts=$(grep "Aborts" ${input}.res | cut -d " " -f 10)
+      echo -e $(basename ${input})",\t"${n}",\t\t"${commit}",\t"${timed}",\t"${routed}",\t"${retries}",\t"${aborts}",\t"${maxrss}
+    done
+  done
+done
@@ -0,0 +1,46 @@
+#!/usr/bin/bash
+
+# compare the grid memory layouts of the ParSolver
+# for each input file and expansion engine, run every layout and report
+# the elapsed time and the number of paths routed
+
+par="../CircuitRouter-ParSolver/CircuitRouter-ParSolver"
+input_folder='../inputs'
+layouts="linear tiled"
+engines=${ENGINES:-"lee astar dial"}
+
+if [ $# -ne 1 ]
+then
+  echo "usage: $0 <n_threads> [extra ParSolver options in OPTS]"
+  exit 1
+elif [[ ! -x $par ]]
+then
+  echo "executable not found"
+  exit 1
+fi
+
+echo -e "#input,\t\tengine,\tlayout,\ttime,\t\trouted"
+for input in ${input_folder}/*.txt
+do
+  for engine in ${engines}
+  do
+    for layout in ${layouts}
+    do
+      ${par} -t $1 -e ${engine} -l ${layout} ${OPTS} ${input} > /dev/null
+      ret=$?
+      if [[ $ret -ne 0 ]]
+      then
+        echo "An error occurred: ParSolver returned "$ret". Aborting"
+        exit $ret
+      fi
+      if ! grep -q "Verification passed" ${input}.res
+      then
+        echo "Verification failed: "${input}" -e "${engine}" -l "${layout}
+        exit 1
+      fi
+      timed=$(grep "Elapsed time" ${input}.res | cut -d " " -f 5)
+      routed=$(grep "Paths routed" ${input}.res | cut -d " " -f 5)
+      echo -e $(basename ${input})",\t"${engine}",\t"${layout}",\t"${timed}",\t"${routed}
+    done
+  done
+done
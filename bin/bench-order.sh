@@ -0,0 +1,48 @@
+#!/usr/bin/bash
+
+# compare the net orderings of the ParSolver work queue
+# for each input file and expansion engine, run every ordering and report
+# the elapsed time, the number of paths routed and the number of nets
+# requeued after a failed commit
+
+par="../CircuitRouter-ParSolver/CircuitRouter-ParSolver"
+input_folder='../inputs'
+orders=${ORDERS:-"distance shortest longest area hilbert random"}
+engines=${ENGINES:-"lee astar dial"}
+
+if [ $# -ne 1 ]
+then
+  echo "usage: $0 <n_threads> [extra ParSolver options in OPTS]"
+  exit 1
+elif [[ ! -x $par ]]
+then
+  echo "executable not found"
+  exit 1
+fi
+
+echo -e "#input,\t\tengine,\torder,\t\ttime,\t\trouted,\tretries"
+for input in ${input_folder}/*.txt
+do
+  for engine in ${engines}
+  do
+    for order in ${orders}
+    do
+      ${par} -t $1 -e ${engine} -o ${order} ${OPTS} ${input} > /dev/null
+      ret=$?
+      if [[ $ret -ne 0 ]]
+      then
+        echo "An error occurred: ParSolver returned "$ret". Aborting"
+        exit $ret
+      fi
+      if ! grep -q "Verification passed" ${input}.res
+      then
+        echo "Verification failed: "${input}" -e "${engine}" -o "${order}
+        exit 1
+      fi
+      timed=$(grep "Elapsed time" ${input}.res | cut -d " " -f 5)
+      routed=$(grep "Paths routed" ${input}.res | cut -d " " -f 5)
+      retries=$(grep "Retries" ${input}.res | cut -d " " -f 9)
+      echo -e $(basename ${input})",\t"${engine}",\t"${order}",\t"${timed}",\t"${routed}",\t"${retries}
+    done
+  done
+done
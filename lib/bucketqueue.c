@@ -0,0 +1,188 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * bucketqueue.c
+ *
+ * monotone priority queue of 32-bit indices keyed by small non-negative
+ * integers (Dial's algorithm): one FIFO bucket per key, kept in a ring
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bucketqueue.h"
+#include "types.h"
+
+
+typedef struct bucket {
+  uint32_t* elements;
+  long capacity;
+  long pop;  /* points to next element to pop */
+  long push; /* points to next free slot */
+} bucket_t;
+
+struct bucketqueue {
+  long numBucket; /* maxIncrement + 1, so pushable keys never share a bucket */
+  long minKey;    /* key of the bucket the next pop starts looking at */
+  long minBucket; /* minKey % numBucket */
+  long size;
+  bucket_t* buckets;
+};
+
+
+/* =============================================================================
+ * bucketqueue_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+bucketqueue_t*
+bucketqueue_alloc (long maxIncrement)
+{
+  assert(maxIncrement >= 0);
+
+  bucketqueue_t* bucketqueuePtr = (bucketqueue_t*)malloc(sizeof(bucketqueue_t));
+  if (bucketqueuePtr == NULL) {
+    return NULL;
+  }
+
+  long numBucket = maxIncrement + 1;
+  bucketqueuePtr->buckets = (bucket_t*)calloc(numBucket, sizeof(bucket_t));
+  if (bucketqueuePtr->buckets == NULL) {
+    free(bucketqueuePtr);
+    return NULL;
+  }
+  bucketqueuePtr->numBucket = numBucket;
+
+  bucketqueue_clear(bucketqueuePtr);
+
+  return bucketqueuePtr;
+}
+
+
+/* =============================================================================
+ * bucketqueue_free
+ * =============================================================================
+ */
+void
+bucketqueue_free (bucketqueue_t* bucketqueuePtr)
+{
+  long b;
+  for (b = 0; b < bucketqueuePtr->numBucket; b++) {
+    free(bucketqueuePtr->buckets[b].elements);
+  }
+  free(bucketqueuePtr->buckets);
+  free(bucketqueuePtr);
+}
+
+
+/* =============================================================================
+ * bucketqueue_isEmpty
+ * =============================================================================
+ */
+bool_t
+bucketqueue_isEmpty (bucketqueue_t* bucketqueuePtr)
+{
+  return ((bucketqueuePtr->size == 0) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * bucketqueue_clear
+ * -- Buckets keep their storage
+ * =============================================================================
+ */
+void
+bucketqueue_clear (bucketqueue_t* bucketqueuePtr)
+{
+  long b;
+  for (b = 0; b < bucketqueuePtr->numBucket; b++) {
+    bucketqueuePtr->buckets[b].pop = 0;
+    bucketqueuePtr->buckets[b].push = 0;
+  }
+  bucketqueuePtr->minKey = 0;
+  bucketqueuePtr->minBucket = 0;
+  bucketqueuePtr->size = 0;
+}
+
+
+/* =============================================================================
+ * bucketqueue_push
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+bucketqueue_push (bucketqueue_t* bucketqueuePtr, long key, uint32_t index)
+{
+  long numBucket = bucketqueuePtr->numBucket;
+
+  assert(key >= bucketqueuePtr->minKey);
+  assert(key < bucketqueuePtr->minKey + numBucket);
+
+  long b = bucketqueuePtr->minBucket + (key - bucketqueuePtr->minKey);
+  if (b >= numBucket) {
+    b -= numBucket;
+  }
+  bucket_t* bucketPtr = &bucketqueuePtr->buckets[b];
+
+  if (bucketPtr->push == bucketPtr->capacity) {
+    long newCapacity = ((bucketPtr->capacity > 0) ? (2 * bucketPtr->capacity) : 1024);
+    uint32_t* newElements = (uint32_t*)realloc(bucketPtr->elements, newCapacity * sizeof(uint32_t));
+    if (newElements == NULL) {
+      return FALSE;
+    }
+    bucketPtr->elements = newElements;
+    bucketPtr->capacity = newCapacity;
+  }
+  bucketPtr->elements[bucketPtr->push++] = index;
+  bucketqueuePtr->size++;
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * bucketqueue_pop
+ * -- Removes an index with the smallest key; its key is stored in keyPtr
+ * -- Queue must not be empty
+ * =============================================================================
+ */
+uint32_t
+bucketqueue_pop (bucketqueue_t* bucketqueuePtr, long* keyPtr)
+{
+  assert(bucketqueuePtr->size > 0);
+
+  long numBucket = bucketqueuePtr->numBucket;
+  long minKey = bucketqueuePtr->minKey;
+  long b = bucketqueuePtr->minBucket;
+  bucket_t* bucketPtr = &bucketqueuePtr->buckets[b];
+  while (bucketPtr->pop == bucketPtr->push) {
+    minKey++;
+    if (++b == numBucket) {
+      b = 0;
+    }
+    bucketPtr = &bucketqueuePtr->buckets[b];
+  }
+  bucketqueuePtr->minKey = minKey;
+  bucketqueuePtr->minBucket = b;
+  bucketqueuePtr->size--;
+
+  if (keyPtr) {
+    *keyPtr = minKey;
+  }
+  uint32_t index = bucketPtr->elements[bucketPtr->pop++];
+  if (bucketPtr->pop == bucketPtr->push) {
+    /* drained: the next key to land here starts at the front again */
+    bucketPtr->pop = 0;
+    bucketPtr->push = 0;
+  }
+  return index;
+}
+
+
+/* =============================================================================
+ *
+ * End of bucketqueue.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * bucketqueue.h
+ *
+ * monotone priority queue of 32-bit indices keyed by small non-negative
+ * integers (Dial's algorithm): one FIFO bucket per key, kept in a ring
+ *
+ * every key pushed must lie in [k, k + maxIncrement], where k is the key of
+ * the last element popped (0 after a clear); elements with the same key
+ * come out in insertion order
+ * =============================================================================
+ */
+
+
+#ifndef BUCKETQUEUE_H
+#define BUCKETQUEUE_H 1
+
+#include <stdint.h>
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct bucketqueue bucketqueue_t;
+
+
+/* =============================================================================
+ * bucketqueue_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+bucketqueue_t*
+bucketqueue_alloc (long maxIncrement);
+
+
+/* =============================================================================
+ * bucketqueue_free
+ * =============================================================================
+ */
+void
+bucketqueue_free (bucketqueue_t* bucketqueuePtr);
+
+
+/* =============================================================================
+ * bucketqueue_isEmpty
+ * =============================================================================
+ */
+bool_t
+bucketqueue_isEmpty (bucketqueue_t* bucketqueuePtr);
+
+
+/* =============================================================================
+ * bucketqueue_clear
+ * =============================================================================
+ */
+void
+bucketqueue_clear (bucketqueue_t* bucketqueuePtr);
+
+
+/* =============================================================================
+ * bucketqueue_push
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+bucketqueue_push (bucketqueue_t* bucketqueuePtr, long key, uint32_t index);
+
+
+/* =============================================================================
+ * bucketqueue_pop
+ * -- Removes an index with the smallest key; its key is stored in keyPtr
+ * -- Queue must not be empty
+ * =============================================================================
+ */
+uint32_t
+bucketqueue_pop (bucketqueue_t* bucketqueuePtr, long* keyPtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* BUCKETQUEUE_H */
+
+
+/* =============================================================================
+ *
+ * End of bucketqueue.h
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,189 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * heap.c
+ *
+ * binary min-heap of (key, data) entries
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "heap.h"
+#include "types.h"
+
+
+typedef struct heap_entry {
+  long key;
+  void* dataPtr;
+} heap_entry_t;
+
+struct heap {
+  long size;
+  long capacity;
+  heap_entry_t* elements;
+};
+
+enum config {
+  HEAP_GROWTH_FACTOR = 2,
+};
+
+
+/* =============================================================================
+ * heap_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+heap_t*
+heap_alloc (long initCapacity)
+{
+  heap_t* heapPtr = (heap_t*)malloc(sizeof(heap_t));
+
+  if (heapPtr) {
+    long capacity = ((initCapacity < 1) ? 1 : initCapacity);
+    heapPtr->elements = (heap_entry_t*)malloc(capacity * sizeof(heap_entry_t));
+    if (heapPtr->elements == NULL) {
+      free(heapPtr);
+      return NULL;
+    }
+    heapPtr->size = 0;
+    heapPtr->capacity = capacity;
+  }
+
+  return heapPtr;
+}
+
+
+/* =============================================================================
+ * heap_free
+ * =============================================================================
+ */
+void
+heap_free (heap_t* heapPtr)
+{
+  free(heapPtr->elements);
+  free(heapPtr);
+}
+
+
+/* =============================================================================
+ * heap_isEmpty
+ * =============================================================================
+ */
+bool_t
+heap_isEmpty (heap_t* heapPtr)
+{
+  return ((heapPtr->size == 0) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * heap_getSize
+ * =============================================================================
+ */
+long
+heap_getSize (heap_t* heapPtr)
+{
+  return heapPtr->size;
+}
+
+
+/* =============================================================================
+ * heap_clear
+ * =============================================================================
+ */
+void
+heap_clear (heap_t* heapPtr)
+{
+  heapPtr->size = 0;
+}
+
+
+/* =============================================================================
+ * heap_insert
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+heap_insert (heap_t* heapPtr, long key, void* dataPtr)
+{
+  if (heapPtr->size == heapPtr->capacity) {
+    long newCapacity = heapPtr->capacity * HEAP_GROWTH_FACTOR;
+    heap_entry_t* newElements =
+      (heap_entry_t*)realloc(heapPtr->elements, newCapacity * sizeof(heap_entry_t));
+    if (newElements == NULL) {
+      return FALSE;
+    }
+    heapPtr->elements = newElements;
+    heapPtr->capacity = newCapacity;
+  }
+
+  /* sift up */
+  heap_entry_t* elements = heapPtr->elements;
+  long i = heapPtr->size++;
+  while (i > 0) {
+    long parent = (i - 1) / 2;
+    if (elements[parent].key <= key) {
+      break;
+    }
+    elements[i] = elements[parent];
+    i = parent;
+  }
+  elements[i].key = key;
+  elements[i].dataPtr = dataPtr;
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * heap_remove
+ * -- Removes the entry with the smallest key; its key is stored in keyPtr
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+void*
+heap_remove (heap_t* heapPtr, long* keyPtr)
+{
+  if (heapPtr->size == 0) {
+    return NULL;
+  }
+
+  heap_entry_t* elements = heapPtr->elements;
+  heap_entry_t top = elements[0];
+  heap_entry_t last = elements[--heapPtr->size];
+  long size = heapPtr->size;
+
+  /* sift down */
+  long i = 0;
+  while (1) {
+    long child = 2 * i + 1;
+    if (child >= size) {
+      break;
+    }
+    if ((child + 1) < size && elements[child + 1].key < elements[child].key) {
+      child++;
+    }
+    if (last.key <= elements[child].key) {
+      break;
+    }
+    elements[i] = elements[child];
+    i = child;
+  }
+  if (size > 0) {
+    elements[i] = last;
+  }
+
+  if (keyPtr) {
+    *keyPtr = top.key;
+  }
+  return top.dataPtr;
+}
+
+
+/* =============================================================================
+ *
+ * End of heap.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * heap.h
+ *
+ * binary min-heap of (key, data) entries
+ *
+ * keys are stored next to the data so that ordering never has to chase
+ * the data pointer; entries are never updated in place, callers that need
+ * decrease-key push a new entry and discard stale ones on removal
+ * =============================================================================
+ */
+
+
+#ifndef HEAP_H
+#define HEAP_H 1
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct heap heap_t;
+
+
+/* =============================================================================
+ * heap_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+heap_t*
+heap_alloc (long initCapacity);
+
+
+/* =============================================================================
+ * heap_free
+ * =============================================================================
+ */
+void
+heap_free (heap_t* heapPtr);
+
+
+/* =============================================================================
+ * heap_isEmpty
+ * =============================================================================
+ */
+bool_t
+heap_isEmpty (heap_t* heapPtr);
+
+
+/* =============================================================================
+ * heap_getSize
+ * =============================================================================
+ */
+long
+heap_getSize (heap_t* heapPtr);
+
+
+/* =============================================================================
+ * heap_clear
+ * =============================================================================
+ */
+void
+heap_clear (heap_t* heapPtr);
+
+
+/* =============================================================================
+ * heap_insert
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+heap_insert (heap_t* heapPtr, long key, void* dataPtr);
+
+
+/* =============================================================================
+ * heap_remove
+ * -- Removes the entry with the smallest key; its key is stored in keyPtr
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+void*
+heap_remove (heap_t* heapPtr, long* keyPtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* HEAP_H */
+
+
+/* =============================================================================
+ *
+ * End of heap.h
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,149 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * indexqueue.c
+ *
+ * FIFO of 32-bit indices in [0, numIndex), in a ring allocated once
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "indexqueue.h"
+#include "types.h"
+
+
+struct indexqueue {
+  uint32_t* elements; /* ring, power-of-two capacity >= numIndex */
+  uint32_t* members;  /* one bit per index, set while it is queued */
+  long mask;
+  long pop;           /* points to next element to pop */
+  long size;
+};
+
+
+/* =============================================================================
+ * indexqueue_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+indexqueue_t*
+indexqueue_alloc (long numIndex)
+{
+  assert(numIndex > 0 && numIndex <= ((long)UINT32_MAX + 1));
+
+  indexqueue_t* indexqueuePtr = (indexqueue_t*)malloc(sizeof(indexqueue_t));
+  if (indexqueuePtr == NULL) {
+    return NULL;
+  }
+
+  long capacity = 1;
+  while (capacity < numIndex) {
+    capacity <<= 1;
+  }
+
+  indexqueuePtr->elements = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+  indexqueuePtr->members = (uint32_t*)calloc(((numIndex + 31) / 32), sizeof(uint32_t));
+  if (indexqueuePtr->elements == NULL || indexqueuePtr->members == NULL) {
+    free(indexqueuePtr->elements);
+    free(indexqueuePtr->members);
+    free(indexqueuePtr);
+    return NULL;
+  }
+  indexqueuePtr->mask = capacity - 1;
+  indexqueuePtr->pop = 0;
+  indexqueuePtr->size = 0;
+
+  return indexqueuePtr;
+}
+
+
+/* =============================================================================
+ * indexqueue_free
+ * =============================================================================
+ */
+void
+indexqueue_free (indexqueue_t* indexqueuePtr)
+{
+  free(indexqueuePtr->elements);
+  free(indexqueuePtr->members);
+  free(indexqueuePtr);
+}
+
+
+/* =============================================================================
+ * indexqueue_isEmpty
+ * =============================================================================
+ */
+bool_t
+indexqueue_isEmpty (indexqueue_t* indexqueuePtr)
+{
+  return ((indexqueuePtr->size == 0) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * indexqueue_clear
+ * -- O(number of queued indices)
+ * =============================================================================
+ */
+void
+indexqueue_clear (indexqueue_t* indexqueuePtr)
+{
+  while (indexqueuePtr->size > 0) {
+    indexqueue_pop(indexqueuePtr);
+  }
+  indexqueuePtr->pop = 0;
+}
+
+
+/* =============================================================================
+ * indexqueue_push
+ * -- Returns FALSE if the index was already queued
+ * =============================================================================
+ */
+bool_t
+indexqueue_push (indexqueue_t* indexqueuePtr, uint32_t index)
+{
+  uint32_t* wordPtr = &indexqueuePtr->members[index >> 5];
+  uint32_t bit = (uint32_t)1 << (index & 31);
+  if (*wordPtr & bit) {
+    return FALSE;
+  }
+  (*wordPtr) |= bit;
+
+  assert(indexqueuePtr->size <= indexqueuePtr->mask);
+  long push = (indexqueuePtr->pop + indexqueuePtr->size) & indexqueuePtr->mask;
+  indexqueuePtr->elements[push] = index;
+  indexqueuePtr->size++;
+
+  return TRUE;
+}
+
+
+/* =============================================================================
+ * indexqueue_pop
+ * -- Queue must not be empty
+ * =============================================================================
+ */
+uint32_t
+indexqueue_pop (indexqueue_t* indexqueuePtr)
+{
+  assert(indexqueuePtr->size > 0);
+
+  uint32_t index = indexqueuePtr->elements[indexqueuePtr->pop];
+  indexqueuePtr->pop = (indexqueuePtr->pop + 1) & indexqueuePtr->mask;
+  indexqueuePtr->size--;
+  indexqueuePtr->members[index >> 5] &= ~((uint32_t)1 << (index & 31));
+
+  return index;
+}
+
+
+/* =============================================================================
+ *
+ * End of indexqueue.c
+ *
+ * =============================================================================
+ */
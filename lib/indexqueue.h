@@ -0,0 +1,93 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * indexqueue.h
+ *
+ * FIFO of 32-bit indices in [0, numIndex), in a ring allocated once
+ *
+ * an index is held at most once: pushing one that is already queued is a
+ * no-op, so numIndex slots are always enough and the ring never grows
+ * =============================================================================
+ */
+
+
+#ifndef INDEXQUEUE_H
+#define INDEXQUEUE_H 1
+
+#include <stdint.h>
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct indexqueue indexqueue_t;
+
+
+/* =============================================================================
+ * indexqueue_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+indexqueue_t*
+indexqueue_alloc (long numIndex);
+
+
+/* =============================================================================
+ * indexqueue_free
+ * =============================================================================
+ */
+void
+indexqueue_free (indexqueue_t* indexqueuePtr);
+
+
+/* =============================================================================
+ * indexqueue_isEmpty
+ * =============================================================================
+ */
+bool_t
+indexqueue_isEmpty (indexqueue_t* indexqueuePtr);
+
+
+/* =============================================================================
+ * indexqueue_clear
+ * -- O(number of queued indices)
+ * =============================================================================
+ */
+void
+indexqueue_clear (indexqueue_t* indexqueuePtr);
+
+
+/* =============================================================================
+ * indexqueue_push
+ * -- Returns FALSE if the index was already queued
+ * =============================================================================
+ */
+bool_t
+indexqueue_push (indexqueue_t* indexqueuePtr, uint32_t index);
+
+
+/* =============================================================================
+ * indexqueue_pop
+ * -- Queue must not be empty
+ * =============================================================================
+ */
+uint32_t
+indexqueue_pop (indexqueue_t* indexqueuePtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* INDEXQUEUE_H */
+
+
+/* =============================================================================
+ *
+ * End of indexqueue.h
+ *
+ * =============================================================================
+ */
@@ -140,6 +140,21 @@ queue_isEmpty (queue_t* queuePtr)
 }
 
 
+/* =============================================================================
+ * queue_getSize
+ * =============================================================================
+ */
+long
+queue_getSize (queue_t* queuePtr)
+{
+  long pop   = queuePtr->pop;
+  long push   = queuePtr->push;
+  long capacity = queuePtr->capacity;
+
+  return ((push - pop - 1 + capacity) % capacity);
+}
+
+
 /* =============================================================================
  * queue_clear
  * =============================================================================
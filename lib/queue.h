@@ -107,6 +107,14 @@ bool_t
 queue_isEmpty (queue_t* queuePtr);
 
 
+/* =============================================================================
+ * queue_getSize
+ * =============================================================================
+ */
+long
+queue_getSize (queue_t* queuePtr);
+
+
 /* =============================================================================
  * queue_clear
  * =============================================================================